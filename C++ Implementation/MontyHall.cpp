@@ -5,13 +5,41 @@
 #include <random>
 #include <chrono>
 #include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <csignal>
+#include <map>
+#include <climits>
+#if defined(__BMI2__) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <utime.h>
+#endif
 
 // Set up the argument parser.
 #include "Include/cxxopts.hpp"
 
 using namespace std;
 #define mtrand(a,b)             uniform_int_distribution<int>(a, b)(rng)
-mt19937 rng(chrono::steady_clock::now().time_since_epoch().count());
+// Every thread has its own generator. Threads that simulate games reseed theirs from the main thread's.
+thread_local mt19937 rng(chrono::steady_clock::now().time_since_epoch().count());
 
 /* Function to run a single simulation of the Monty Hall Problem.
     Return Type:
@@ -49,6 +77,473 @@ pair<bool, bool> scenario_statistics_optimal(int n,int k){
     return pair<bool, bool>{stay_success, switch_success};
 }
 
+/*  Function to run an antithetic pair of simulations of the Monty Hall Problem.
+    Return Type:
+    - It returns the results of both games, each as in `scenario_statistics_optimal()`.
+
+    Methodology:
+    - The first game draws `car_idx`, `player_idx` and `dice_roll` exactly like `scenario_statistics_optimal()`.
+    - The second game moves the car half way around the doors, to `car_idx + n/2` (wrapping around), keeps `player_idx`,
+      and uses the mirrored `R+1-dice_roll`. Each of them is still uniform, so the second game on its own is an ordinary game.
+    - The two cars are never behind the same door, so at most one of the games is won by staying, and `dice_roll == 1` rules out
+      `R+1-dice_roll == 1` (unless R = 1). The results of the two games are negatively correlated, so their average varies less than that of
+      two independent games. (Mirroring the car to `n+1-car_idx` would not do: for odd n both games are then won by staying exactly as often
+      as two independent ones.)
+    - For an event of probability p, at most one of two games winning cuts the variance by a factor `(1-p)/(1-2p)`, so the gain is largest for few doors.
+*/
+pair<pair<bool, bool>, pair<bool, bool> > scenario_statistics_antithetic(int n, int k) {
+    int car_idx = mtrand(1, n);
+    int player_idx = mtrand(1, n);
+    int remaining = n - k - 1;
+    int dice_roll = mtrand(1, remaining);
+    int moved_car_idx = (car_idx - 1 + n / 2) % n + 1;
+    int mirrored_dice_roll = remaining + 1 - dice_roll;
+
+    pair<bool, bool> first{car_idx == player_idx, car_idx != player_idx && dice_roll == 1};
+    pair<bool, bool> second{moved_car_idx == player_idx, moved_car_idx != player_idx && mirrored_dice_roll == 1};
+    return make_pair(first, second);
+}
+
+__extension__ typedef unsigned __int128 uint128;
+
+/*  Function to write a 128-bit unsigned integer in decimal. */
+string uint128_to_string(uint128 x) {
+    string digits;
+    do {
+        digits += static_cast<char>('0' + static_cast<int>(x % 10));
+        x /= 10;
+    } while (x > 0);
+    return string(digits.rbegin(), digits.rend());
+}
+
+uint128 gcd128(uint128 a, uint128 b) {
+    while (b != 0) {
+        uint128 r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+/*  An exact non-negative fraction `num/den`, always kept in lowest terms.
+    128-bit parts hold n*(n-k-1) and the products of the exact engines without overflow for any `int` n.
+*/
+struct Fraction {
+    uint128 num;
+    uint128 den;
+
+    Fraction(uint128 num = 0, uint128 den = 1) : num(num), den(den) {
+        uint128 g = gcd128(num, den);
+        if (g > 1) {
+            this->num /= g;
+            this->den /= g;
+        }
+    }
+    Fraction operator+(const Fraction& o) const {
+        uint128 g = gcd128(den, o.den);
+        return Fraction(num * (o.den / g) + o.num * (den / g), den / g * o.den);
+    }
+    Fraction operator*(const Fraction& o) const {
+        uint128 g1 = gcd128(num, o.den);
+        uint128 g2 = gcd128(o.num, den);
+        return Fraction((num / g1) * (o.num / g2), (den / g2) * (o.den / g1));
+    }
+    bool operator==(const Fraction& o) const { return num == o.num && den == o.den; }
+    long double value() const { return static_cast<long double>(num) / static_cast<long double>(den); }
+    string str() const { return uint128_to_string(num) + "/" + uint128_to_string(den); }
+};
+
+/*  Function to compute the exact winning probabilities of the Monty Hall Problem.
+    Return Type:
+    - It returns a pair of fractions: `<stay_probability, switch_probability>`.
+
+    Methodology:
+    - This is the closed form behind `scenario_statistics_optimal()`, derived in Explanation_MontyHall.pdf.
+    - Staying wins if and only if the player picked the car at first: 1/n.
+    - Switching wins if the player did not pick the car at first, (n-1)/n, and then lands on it among the `R = n-k-1` remaining doors, 1/R.
+
+    Time Complexity:
+    - O(log n), for reducing the fractions.
+*/
+pair<Fraction, Fraction> exact_statistics(int n, int k) {
+    uint128 remaining = n - k - 1;
+    return pair<Fraction, Fraction>{Fraction(1, n), Fraction(n - 1, static_cast<uint128>(n) * remaining)};
+}
+
+// Number of standard errors by which a simulated win rate may miss the exact one before `--verify` reports a failure.
+const double VERIFY_MAX_DEVIATION = 5;
+
+/*  Function to check simulated win rates against the exact probabilities.
+    Return Type:
+    - It returns false if either win rate is more than `VERIFY_MAX_DEVIATION` standard errors away from the exact probability.
+*/
+bool verify_estimates(int n, int k, const double estimates[2], const double std_errors[2]) {
+    pair<Fraction, Fraction> exact = exact_statistics(n, k);
+    const Fraction* probabilities[2] = {&exact.first, &exact.second};
+    bool consistent = true;
+    for (int i = 0; i < 2; i++) {
+        double p = probabilities[i]->value();
+        double deviation = std_errors[i] > 0 ? (estimates[i] - p) / std_errors[i] : (estimates[i] == p ? 0 : INFINITY);
+        bool ok = fabs(deviation) <= VERIFY_MAX_DEVIATION;
+        consistent = consistent && ok;
+        cout << "Scenario " << i + 1 << " check: exact " << probabilities[i]->str() << ", simulated win rate is off by "
+             << deviation << " standard errors" << (ok ? "." : ", which is too far.") << endl;
+    }
+    return consistent;
+}
+
+/*  Function to check simulated win counts against the exact probabilities.
+    Methodology:
+    - For an exact probability p, the win rate of `simulations` independent games has standard error sqrt(p * (1-p) / simulations).
+*/
+bool verify_against_exact(int n, int k, long long simulations, long long stay_cnt, long long switch_cnt) {
+    pair<Fraction, Fraction> exact = exact_statistics(n, k);
+    double estimates[2] = {static_cast<double>(stay_cnt) / simulations, static_cast<double>(switch_cnt) / simulations};
+    double std_errors[2];
+    std_errors[0] = sqrt(exact.first.value() * (1 - exact.first.value()) / simulations);
+    std_errors[1] = sqrt(exact.second.value() * (1 - exact.second.value()) / simulations);
+    return verify_estimates(n, k, estimates, std_errors);
+}
+
+/*  Function to run a single simulation of the Monty Hall Problem with importance sampling.
+    Return Type:
+    - It returns a pair of boolean value: `<stay_hit, switch_hit>`, whether the game was won by staying or switching.
+      The games are not drawn with the true probabilities, so the hits must be weighted by `importance_weights()`.
+
+    Methodology:
+    - With probability `bias` the player's choice is set to the car, otherwise it is drawn uniformly as usual.
+      Likewise, with probability `bias` the switching player lands on the car (`dice_roll = 1`), otherwise the dice is rolled as usual.
+    - Both rare events then happen in about a `bias` share of the games, instead of 1/n and 1/R.
+*/
+pair<bool, bool> scenario_statistics_importance(int n, int k, double bias) {
+    bernoulli_distribution biased(bias);
+    int car_idx = mtrand(1, n);
+    int player_idx = biased(rng) ? car_idx : mtrand(1, n);
+    int remaining = n - k - 1;
+    int dice_roll = biased(rng) ? 1 : mtrand(1, remaining);
+
+    bool stay_hit = car_idx == player_idx;
+    bool switch_hit = car_idx != player_idx && dice_roll == 1;
+    return pair<bool, bool>{stay_hit, switch_hit};
+}
+
+/*  Function to compute the likelihood ratios that turn the hits of `scenario_statistics_importance()` into unbiased estimates.
+    Return Type:
+    - It returns `<stay_weight, switch_weight>`: a stay hit stands for `stay_weight` true wins, a switch hit for `switch_weight`.
+
+    Methodology:
+    - A stay hit needs `player_idx == car_idx`, which has true probability 1/n and biased probability `bias + (1-bias)/n`.
+      The dice does not matter for staying, so its ratio (which averages to 1) is left out.
+    - A switch hit needs `player_idx != car_idx` (true 1 - 1/n, biased (1-bias)(1 - 1/n)) and `dice_roll == 1` (true 1/R, biased `bias + (1-bias)/R`).
+    - Every hit of a scenario has the same weight, so the estimate is `weight * hits / simulations`.
+*/
+pair<double, double> importance_weights(int n, int k, double bias) {
+    double remaining = n - k - 1;
+    double stay_weight = (1.0 / n) / (bias + (1 - bias) / n);
+    double switch_weight = 1 / (1 - bias) * (1 / remaining) / (bias + (1 - bias) / remaining);
+    return pair<double, double>{stay_weight, switch_weight};
+}
+
+/*  Function to turn the hits of an importance sampling run into estimates and standard errors.
+    - A hit rate h of `simulations` games has standard error sqrt(h(1-h)/simulations), which scales with the constant weight.
+*/
+void importance_estimates(int n, int k, double bias, long long simulations, long long stay_hits, long long switch_hits, double estimates[2], double std_errors[2]) {
+    pair<double, double> weights = importance_weights(n, k, bias);
+    double w[2] = {weights.first, weights.second};
+    long long hits[2] = {stay_hits, switch_hits};
+    for (int i = 0; i < 2; i++) {
+        double h = static_cast<double>(hits[i]) / simulations;
+        estimates[i] = w[i] * h;
+        std_errors[i] = w[i] * sqrt(h * (1 - h) / simulations);
+    }
+}
+
+// Outcome of a single game, as written to the `--outcomes` file (one byte per game).
+const uint8_t OUTCOME_LOST = 0;             // Lost whether the player stays or switches.
+const uint8_t OUTCOME_STAY = 1;             // Won by staying.
+const uint8_t OUTCOME_SWITCH = 2;           // Won by switching.
+
+/*  Precomputed thresholds of `scenario_outcomes()` for given n and k.
+    - A game is summarised by one draw `u`, uniform in [0, n*R) where `R = n-k-1`.
+    - `u < stay_ways` (R values) means the game is won by staying, the next `switch_ways` (n-1 values) mean it is won by switching.
+*/
+struct OutcomeKernel {
+    uint64_t stay_ways;
+    uint64_t switch_ways;
+    uniform_int_distribution<uint64_t> draw;
+
+    OutcomeKernel(int n, int k)
+        : stay_ways(n - k - 1), switch_ways(n - 1),
+          draw(0, static_cast<uint64_t>(n) * (n - k - 1) - 1) {}
+};
+
+/*  Function to simulate `count` games of the Monty Hall Problem and write the outcome of each one to `out`.
+    Return Type:
+    - `out[i]` is `OUTCOME_STAY`, `OUTCOME_SWITCH` or `OUTCOME_LOST`.
+
+    Methodology:
+    - `scenario_statistics_optimal()` draws three numbers, `car_idx` and `player_idx` in [1, n] and `dice_roll` in [1, R]. Every one of the n*n*R triples is equally likely.
+    - The game is won by staying for the n*R triples with `car_idx == player_idx`, i.e. with probability R/(n*R).
+    - It is won by switching for the n*(n-1) triples with `car_idx != player_idx && dice_roll == 1`, i.e. with probability (n-1)/(n*R).
+    - So a single uniform draw from [0, n*R) compared against the thresholds of `OutcomeKernel` gives exactly the same distribution of outcomes.
+      The comparison is branch free: `u - stay_ways` wraps around for `u < stay_ways`, so it is below `switch_ways` only for the switching range.
+
+    Time Complexity per simulation:
+    - O(K), a single random draw instead of three.
+*/
+void scenario_outcomes(OutcomeKernel& kernel, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint64_t u = kernel.draw(rng);
+        out[i] = (u < kernel.stay_ways) | (u - kernel.stay_ways < kernel.switch_ways) << 1;
+    }
+}
+
+/*  Function to find the index of the r-th (0-based) set bit of a 64-bit mask.
+    - With BMI2, `_pdep_u64(1 << r, mask)` deposits a single bit onto the r-th set bit of `mask`, so the answer is one pdep and one count of trailing zeros.
+    - Without BMI2, the lowest set bit is cleared r times instead.
+*/
+inline int select_bit(uint64_t mask, int r) {
+#if defined(__BMI2__)
+    return __builtin_ctzll(_pdep_u64(1ULL << r, mask));
+#else
+    for (int i = 0; i < r; i++) mask &= mask - 1;
+    return __builtin_ctzll(mask);
+#endif
+}
+
+/*  Function to pick a uniformly random door out of the doors present in `mask`. */
+inline int random_door(uint64_t mask) {
+    return select_bit(mask, mtrand(0, __builtin_popcountll(mask) - 1));
+}
+
+/*  Function to run a single simulation of the Monty Hall Problem when n <= 64.
+    Return Type:
+    - Same as `scenario_statistics_randomised()`.
+
+    Methodology:
+    - The whole set of doors is kept in a single 64-bit mask, bit i standing for door i.
+    - `goats` holds the doors the host may open (neither the car nor the player's choice).
+    - The host opens k random doors from `goats`. Choosing which k doors to open is the same as choosing which `|goats| - k` doors to keep closed,
+      so we only draw whichever of the two sets is smaller.
+    - If the player switches, he picks a random door from `alive`, the doors that are still closed other than his own.
+
+    Time Complexity per simulation:
+    - O(min(k, n-k)) random draws, with no memory traffic at all.
+*/
+pair<bool, bool> scenario_statistics_bitmask(int n, int k) {
+    uint64_t all_doors = n == 64 ? ~0ULL : (1ULL << n) - 1;
+    int car_idx = mtrand(0, n-1);                   // Randomly placing car at any door.
+    int player_idx = mtrand(0, n-1);                // Randomly pick choice of the player at any door.
+    uint64_t goats = all_doors & ~(1ULL << car_idx) & ~(1ULL << player_idx);
+
+    uint64_t opened = 0;
+    int goat_cnt = __builtin_popcountll(goats);
+    if (k <= goat_cnt - k) {
+        for (int i = 0; i < k; i++) {
+            opened |= 1ULL << random_door(goats & ~opened);
+        }
+    }
+    else {
+        uint64_t kept = 0;
+        for (int i = 0; i < goat_cnt - k; i++) {
+            kept |= 1ULL << random_door(goats & ~kept);
+        }
+        opened = goats & ~kept;
+    }
+    uint64_t alive = all_doors & ~opened & ~(1ULL << player_idx);
+
+    bool stay_success = 0;
+    bool switch_success = 0;
+    // Case 1. He wins if he stays.
+    if (player_idx == car_idx) stay_success = 1;
+    // Case 2. He wins if he switches.
+    else switch_success = random_door(alive) == car_idx;
+
+    return pair<bool, bool>{stay_success, switch_success};
+}
+
+// Largest number of doors the enumeration engine accepts.
+const int ENUMERATE_MAX_DOORS = 14;
+
+/*  How the host picks the doors he opens, for the enumeration engine.
+    - `HOST_RANDOM`: k uniformly random goat doors other than the player's (the classic host).
+    - `HOST_LEFTMOST`: the k lowest-numbered goat doors other than the player's.
+    - `HOST_IGNORANT`: k uniformly random doors other than the player's. He may reveal the car, and then both strategies lose.
+*/
+enum HostPolicy { HOST_RANDOM, HOST_LEFTMOST, HOST_IGNORANT };
+
+/*  How the player picks the door he switches to, for the enumeration engine.
+    - `SWITCH_RANDOM`: a uniformly random closed door other than his own.
+    - `SWITCH_LEFTMOST`: the lowest-numbered closed door other than his own.
+*/
+enum SwitchPolicy { SWITCH_RANDOM, SWITCH_LEFTMOST };
+
+/*  Function to scatter the low bits of `src` onto the set bits of `mask`, lowest first (the BMI2 `pdep` instruction). */
+inline uint64_t deposit_bits(uint64_t src, uint64_t mask) {
+#if defined(__BMI2__)
+    return _pdep_u64(src, mask);
+#else
+    uint64_t out = 0;
+    for (uint64_t bit = 1; mask != 0; bit <<= 1) {
+        if (src & bit) out |= mask & (~mask + 1);
+        mask &= mask - 1;
+    }
+    return out;
+#endif
+}
+
+/*  Function to compute the exact winning probabilities for small n under any of the host and switching policies above.
+    Return Type:
+    - It returns a pair of fractions: `<stay_probability, switch_probability>`.
+
+    Methodology:
+    - Every car placement and initial choice of the player is visited, each with weight 1/(n*n).
+    - For every such game, every set of doors the host may open is visited with the weight his policy gives it,
+      and then every door the player may switch to, again with the weight of the switching policy.
+      The k-subsets of the host's candidate doors are walked with Gosper's hack over their ranks, and placed onto the doors with `deposit_bits()`.
+    - The random policies do not care about door numbers, so every game with `car_idx == player_idx` (and every game with `car_idx != player_idx`)
+      has the same subtree. The subtrees are memoized under a key that is only `car_idx == player_idx` in that case, so just two of them are enumerated.
+      The leftmost policies depend on the numbering, and then every game is its own key.
+
+    Time Complexity:
+    - O(C(n-1, k) * n) per enumerated subtree.
+*/
+pair<Fraction, Fraction> enumerate_statistics(int n, int k, HostPolicy host, SwitchPolicy switch_rule) {
+    uint64_t all_doors = (1ULL << n) - 1;
+    bool symmetric = host != HOST_LEFTMOST && switch_rule != SWITCH_LEFTMOST;
+    map<int, Fraction> memo;                       // Probability that switching wins, per subtree key.
+
+    Fraction stay_probability, switch_probability;
+    Fraction game_weight(1, static_cast<uint128>(n) * n);
+    for (int car_idx = 0; car_idx < n; car_idx++) {
+        for (int player_idx = 0; player_idx < n; player_idx++) {
+            if (car_idx == player_idx) stay_probability = stay_probability + game_weight;
+
+            int key = symmetric ? (car_idx == player_idx) : car_idx * n + player_idx;
+            map<int, Fraction>::iterator it = memo.find(key);
+            if (it == memo.end()) {
+                uint64_t candidates = all_doors & ~(1ULL << player_idx);
+                if (host != HOST_IGNORANT) candidates &= ~(1ULL << car_idx);
+                int candidate_cnt = __builtin_popcountll(candidates);
+
+                // All the sets of doors the host may open, with their weights.
+                vector<uint64_t> reveals;
+                if (host == HOST_LEFTMOST) {
+                    uint64_t opened = 0, rest = candidates;
+                    for (int i = 0; i < k; i++) {
+                        opened |= rest & (~rest + 1);
+                        rest &= rest - 1;
+                    }
+                    reveals.push_back(opened);
+                }
+                else if (k == 0) reveals.push_back(0);
+                else {
+                    for (uint64_t ranks = (1ULL << k) - 1; ranks < (1ULL << candidate_cnt); ) {
+                        reveals.push_back(deposit_bits(ranks, candidates));
+                        uint64_t low = ranks & (~ranks + 1);
+                        uint64_t ripple = ranks + low;
+                        ranks = (((ripple ^ ranks) >> 2) / low) | ripple;
+                    }
+                }
+                Fraction reveal_weight(1, reveals.size());
+
+                Fraction switch_win;
+                for (size_t r = 0; r < reveals.size(); r++) {
+                    if (reveals[r] >> car_idx & 1) continue;          // The car was revealed, switching can not win.
+                    uint64_t alive = all_doors & ~reveals[r] & ~(1ULL << player_idx);
+                    if (!(alive >> car_idx & 1)) continue;
+                    if (switch_rule == SWITCH_RANDOM) switch_win = switch_win + reveal_weight * Fraction(1, __builtin_popcountll(alive));
+                    else if (__builtin_ctzll(alive) == car_idx) switch_win = switch_win + reveal_weight;
+                }
+                it = memo.insert(make_pair(key, switch_win)).first;
+            }
+            switch_probability = switch_probability + game_weight * it->second;
+        }
+    }
+    return pair<Fraction, Fraction>{stay_probability, switch_probability};
+}
+
+/*  Function to copy every door of `in[0..n)` that is not marked -1 into `out`, keeping their order.
+    Return Type:
+    - It returns the number of doors written to `out`.
+    - `out` must have room for `n + 8` values, as the vectorised loops may store up to a full register past the last kept door.
+    - `out` may also be `in` itself: a store never reaches past the doors that have already been loaded.
+
+    Methodology:
+    - With AVX-512, 16 doors are compared against -1 at a time and the kept ones are written in one `vpcompressd`.
+    - With AVX2, 8 doors are compared at a time. The 8-bit keep mask selects a precomputed permutation from `table`,
+      which moves the kept doors to the front of the register before it is stored.
+    - The remaining tail (and every door, without AVX2) is filtered one element at a time.
+*/
+size_t compact_alive_doors(const int* in, size_t n, int* out) {
+    size_t cnt = 0;
+    size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512i opened = _mm512_set1_epi32(-1);
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = _mm512_loadu_si512(in + i);
+        __mmask16 keep = _mm512_cmpneq_epi32_mask(v, opened);
+        _mm512_mask_compressstoreu_epi32(out + cnt, keep, v);
+        cnt += __builtin_popcount(keep);
+    }
+#elif defined(__AVX2__)
+    struct ShuffleTable {
+        int idx[256][8];
+        ShuffleTable() {
+            for (int m = 0; m < 256; m++) {
+                int c = 0;
+                for (int b = 0; b < 8; b++) if (m >> b & 1) idx[m][c++] = b;
+                while (c < 8) idx[m][c++] = 0;
+            }
+        }
+    };
+    static const ShuffleTable table;
+    const __m256i opened = _mm256_set1_epi32(-1);
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        int keep = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, opened))) & 0xFF;
+        __m256i perm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table.idx[keep]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + cnt), _mm256_permutevar8x32_epi32(v, perm));
+        cnt += __builtin_popcount(keep);
+    }
+#endif
+    for (; i < n; i++) {
+        if (in[i] != -1) out[cnt++] = in[i];
+    }
+    return cnt;
+}
+
+// Number of Fisher-Yates steps by which the swap targets are drawn (and prefetched) ahead of the swaps themselves.
+const int SHUFFLE_PREFETCH_DISTANCE = 16;
+
+/*  Function to move a uniformly random subset of `cnt` values of `a` to its front, in random order.
+    Methodology:
+    - This is the first `cnt` steps of a forward Fisher-Yates shuffle: step i swaps `a[i]` with `a[j]`, j uniform in [i, size-1].
+    - j only depends on i, so the swap targets are drawn `SHUFFLE_PREFETCH_DISTANCE` steps early into the ring buffer `ahead`
+      and `a[j]` is prefetched. Once the array no longer fits in cache, the random accesses then overlap instead of each waiting for DRAM.
+    - `a[i]` is walked sequentially and is left to the hardware prefetcher.
+
+    Time Complexity:
+    - O(cnt).
+*/
+void partial_shuffle(vector<int>& a, int cnt) {
+    const int D = SHUFFLE_PREFETCH_DISTANCE;
+    int size = a.size();
+    int ahead[D];
+    for (int i = 0; i < D && i < cnt; i++) {
+        ahead[i] = mtrand(i, size - 1);
+        __builtin_prefetch(&a[ahead[i]], 1);
+    }
+    for (int i = 0; i < cnt; i++) {
+        int j = ahead[i % D];
+        if (i + D < cnt) {
+            ahead[i % D] = mtrand(i + D, size - 1);
+            __builtin_prefetch(&a[ahead[i % D]], 1);
+        }
+        swap(a[i], a[j]);
+    }
+}
+
 /*  Function to run a single simulation of the Monty Hall Problem.
     Return Type:
     - It returns a pair of boolean value: `<stay_success, switch_success>`
@@ -60,10 +555,13 @@ pair<bool, bool> scenario_statistics_optimal(int n,int k){
     - Choice of Player is randomised.
     
     Methodology:
+    - For n <= 64 the doors fit in a single machine word, so the simulation is handed over to `scenario_statistics_bitmask()`.
     - Firstly, we generate two uniformly random indices `car_idx` and `player_idx` denoting the car door and player's initial choice.
     - `stay_success` = 1 if and only if `car_idx == player_idx`.
     - To reveal `k` doors, all wrong doors in the `temp_doors` vector are randomly shuffled. The first `k` values are the indices of the doors opened.
+      Only the front of the vector needs to be random, so `partial_shuffle()` shuffles just the smaller of the opened (first `k`) and kept (last `n-k-2`) parts.
     - If the player wants to switch, he makes a choice from `alive_doors` which consists of `n-k-2` unrevealed doors and the car `car_idx` as well.
+    - The player's own door is marked -1 like the opened ones, so `alive_doors` is built by a single vectorised compaction of `doors`.
     - `switch_success` = 1 if and only if the randomly chosen door in `alive_doors` has a car behind it.
  
     Time Complexity per simulation: 
@@ -71,6 +569,8 @@ pair<bool, bool> scenario_statistics_optimal(int n,int k){
 */
 
 pair<bool, bool> scenario_statistics_randomised(int n, int k) {
+    if (n <= 64) return scenario_statistics_bitmask(n, k);
+
     vector<int> doors(n, 0);                 // Initializing doors array with all wrong doors (goats). 
     int car_idx = mtrand(0, n-1);            // Randomly placing car at any index of the array.
     doors[car_idx] = 1;
@@ -83,17 +583,24 @@ pair<bool, bool> scenario_statistics_randomised(int n, int k) {
         }
     }
     // Shuffle the wrong doors randomly, then the first k doors will be opened.
-    shuffle(temp_doors.begin(), temp_doors.end(), rng);
-    for(int i = 0; i < k; i++){
+    // If fewer doors stay closed than are opened, shuffle the kept doors to the front and open the back instead.
+    int goat_cnt = temp_doors.size();
+    int first_opened = 0;
+    if (k <= goat_cnt - k) partial_shuffle(temp_doors, k);
+    else {
+        partial_shuffle(temp_doors, goat_cnt - k);
+        first_opened = goat_cnt - k;
+    }
+    for(int i = first_opened; i < first_opened + k; i++){
+        if (i + SHUFFLE_PREFETCH_DISTANCE < goat_cnt) __builtin_prefetch(&doors[temp_doors[i + SHUFFLE_PREFETCH_DISTANCE]], 1);
         doors[temp_doors[i]] = -1;           // Opened doors are assigned -1 and later discarded. 
     }
 
     // Make a new array with n-k-1 doors.
     // alive_doors are those doors which can be chosen if the player switches.
-    vector<int> alive_doors;
-    for (int i = 0; i < doors.size(); i++) {
-        if (doors[i] != -1 && i != player_idx) alive_doors.push_back(doors[i]);
-    }
+    doors[player_idx] = -1;                  // The player's door can not be switched to either.
+    vector<int> alive_doors(doors.size() + 8);
+    alive_doors.resize(compact_alive_doors(doors.data(), doors.size(), alive_doors.data()));
 
     bool stay_success = 0;
     bool switch_success = 0;
@@ -105,67 +612,2636 @@ pair<bool, bool> scenario_statistics_randomised(int n, int k) {
     return pair<bool, bool>{stay_success, switch_success};
 }
 
-/*  Function to repeatedly simulate the Monty Hall Problem. */
-void simulate(int n, int k, int simulations) {
-    int switch_cnt = 0;
-    int stay_cnt = 0;
-    for (int i = 0; i < simulations; i++) {
-        // The below 2 lines provide two different algorithms. Choose from the optimal (default) or randomised simulation. 
-        // Uncomment accordingly.
-        pair<bool, bool> results = scenario_statistics_optimal(n, k);            
-        // pair<bool, bool> results = scenario_statistics_randomised(n, k);
-        
-        // Counting scenario 1 cases.
-        stay_cnt += results.first;
-        // Counting scenario 2 cases.
-        switch_cnt += results.second;
+// Door count from which a randomised simulation is split across threads, when more than one thread is given.
+const int PARALLEL_MIN_DOORS = 1 << 20;
+// Smallest selection probability for which the threads mark doors themselves. Below it, the few doors are picked by rejection sampling.
+const double PARALLEL_MIN_SELECT_PROBABILITY = 1.0 / 1024;
+
+/*  Function to split the indices [0, n) into `threads` contiguous slices and run `work(t, lo, hi)` for slice t on its own thread. */
+template <class Work>
+void parallel_slices(int threads, long long n, Work work) {
+    vector<thread> pool;
+    for (int t = 0; t < threads; t++) {
+        long long lo = static_cast<long long>(static_cast<uint128>(n) * t / threads);
+        long long hi = static_cast<long long>(static_cast<uint128>(n) * (t + 1) / threads);
+        pool.push_back(thread(work, t, lo, hi));
     }
-    double res1 = static_cast<double>(stay_cnt) / static_cast<double>(simulations);
-    double res2 = static_cast<double>(switch_cnt) / static_cast<double>(simulations);
-    
-    cout << "Scenario 1: " << stay_cnt << "/" << simulations<< " = " <<  res1 * 100 << "% wins if player sticks to the initial choice." << endl;
-    cout << "Scenario 2: " << switch_cnt << "/" << simulations<< " = " << res2 * 100 << "% wins if player switches the initial choice." << endl;
+    for (int t = 0; t < threads; t++) pool[t].join();
 }
 
-int main(int argc, char* argv[]) {
-    // Seed the random number generator.
-    srand(time(0));  
-    
-    // Invoking an instance of the cxxopts library.
-    cxxopts::Options options("MontyHall", "Monty Hall Problem Simulator");
+/*  Function to run a single simulation of the Monty Hall Problem, using `threads` threads for a very large n.
+    Return Type:
+    - Same as `scenario_statistics_randomised()`.
 
-    // Parse the command-line arguments if provided, else initialize with default values of original Monty Hall Problem.
-    options.add_options()
-            ("n, num_doors", "Number of doors", cxxopts::value<int>()->default_value("3"))
-            ("k, num_doors_opened_by_host", "Number of doors opened by host", cxxopts::value<int>()->default_value("1"))
-            ("s, num_simulations", "Number of simulations", cxxopts::value<int>()->default_value("10000"))
-            ("h, help", "Print usage");
-    auto result = options.parse(argc, argv);
+    Methodology:
+    - `car_idx` and `player_idx` are drawn as in `scenario_statistics_randomised()`, and the doors array is split into one slice per thread.
+    - The host either opens `k` goat doors or keeps `goat_cnt - k` goat doors closed, whichever set is smaller. Call that set the selected doors.
+    - Every thread marks each goat door of its slice as selected with probability `p = selected_target / goat_cnt`, with its own generator.
+      The gaps between marked doors are geometric, so a thread only does work for the doors it marks.
+    - The total number of marked doors is then fixed up on the main thread: random marked doors are unmarked, or random unmarked goat doors are marked,
+      until exactly `selected_target` doors are selected. Both steps treat all goat doors alike, so the selected set is a uniformly random subset,
+      exactly like the one picked by shuffling.
+    - If `p` is tiny, the threads mark nothing and the fix-up picks all the (few) selected doors by itself.
+    - Every thread then compacts the doors of its slice that are still alive in place. The player picks a random alive door by its rank,
+      which is looked up in the per-slice counts instead of concatenating the slices.
 
-    if (result.count("help")) {
-        cout << options.help() << endl;
-        exit(0);
+    Time Complexity per simulation:
+    - O(N / threads) on every thread, plus O(sqrt(N)) on the main thread for the fix-up.
+*/
+pair<bool, bool> scenario_statistics_parallel(int n, int k, int threads) {
+    int car_idx = mtrand(0, n-1);            // Randomly placing car at any index of the array.
+    int player_idx = mtrand(0, n-1);         // Randomly pick choice of the player at any index of the array.
+    int goat_cnt = n - 1 - (player_idx != car_idx);
+
+    bool select_opened = k <= goat_cnt - k;
+    int selected_target = select_opened ? k : goat_cnt - k;
+    int selected_value = select_opened ? -1 : 0;
+    int unselected_value = select_opened ? 0 : -1;
+    double p = static_cast<double>(selected_target) / goat_cnt;
+    bool mark_in_threads = p >= PARALLEL_MIN_SELECT_PROBABILITY;
+
+    unique_ptr<int[]> doors(new int[n]);
+    vector<unsigned> seeds(threads);
+    for (int t = 0; t < threads; t++) seeds[t] = rng();
+    vector<int> marked(threads, 0);
+    parallel_slices(threads, n, [&](int t, int lo, int hi) {
+        fill(doors.get() + lo, doors.get() + hi, unselected_value);
+        if (!mark_in_threads) return;
+        mt19937 local_rng(seeds[t]);
+        geometric_distribution<int> gap(p);
+        for (long long i = lo + static_cast<long long>(gap(local_rng)); i < hi; i += 1 + static_cast<long long>(gap(local_rng))) {
+            if (i == car_idx || i == player_idx) continue;
+            doors[i] = selected_value;
+            marked[t]++;
+        }
+    });
+    doors[car_idx] = 1;
+
+    // Fix up the number of selected doors.
+    long long selected_cnt = 0;
+    for (int t = 0; t < threads; t++) selected_cnt += marked[t];
+    while (selected_cnt != selected_target) {
+        int i = mtrand(0, n-1);
+        if (i == car_idx || i == player_idx) continue;
+        if (selected_cnt > selected_target && doors[i] == selected_value) {
+            doors[i] = unselected_value;
+            selected_cnt--;
+        }
+        else if (selected_cnt < selected_target && doors[i] == unselected_value) {
+            doors[i] = selected_value;
+            selected_cnt++;
+        }
     }
-    // Assign the values to variables.
-    int n = result["num_doors"].as<int>();
-    int k = result["num_doors_opened_by_host"].as<int>();
-    int s = result["num_simulations"].as<int>();
-    
-    // Error Handling.
-    if(!(3 <= n)){
-        cerr << "There must be a minimum of 3 doors to play the Monty Hall Simulator."<<endl;
-        abort();
+    doors[player_idx] = -1;                  // The player's door can not be switched to either.
+
+    vector<int> alive_cnt(threads);
+    parallel_slices(threads, n, [&](int t, int lo, int hi) {
+        alive_cnt[t] = compact_alive_doors(doors.get() + lo, hi - lo, doors.get() + lo);
+    });
+
+    bool stay_success = 0;
+    bool switch_success = 0;
+    // Case 1. He wins if he stays.
+    if (player_idx == car_idx) stay_success = 1;
+    // Case 2. He wins if he switches.
+    else {
+        int rank = mtrand(0, n - k - 2);     // There are n-k-1 alive doors.
+        int t = 0;
+        while (rank >= alive_cnt[t]) rank -= alive_cnt[t++];
+        switch_success = doors[static_cast<long long>(n) * t / threads + rank];
     }
-    if (!(0 <= k && k <= n - 2)) {
-        cerr << "Invalid number of doors given to open. Must be between 0 and (num_doors - 2)."<< endl;
-        abort(); 
+
+    return pair<bool, bool>{stay_success, switch_success};
+}
+
+/*  Weighted totals of one replicate of the Poisson bootstrap. */
+struct BootstrapReplicate {
+    long long games;
+    long long stay_cnt;
+    long long switch_cnt;
+};
+
+/*  Wins of the games since the previous checkpoint, up to game `games` (exclusive), for `--checkpoints`. */
+struct Checkpoint {
+    long long games;
+    long long stay_cnt;
+    long long switch_cnt;
+};
+
+/*  Sums over the batches of a run, for the batch means standard errors. Games are split into batches of `size` consecutive games,
+    numbered from game 0, and only batches that were simulated completely by one thread are counted.
+    `x` is the number of a batch's games won by staying and `y` the number won by switching.
+*/
+struct BatchMoments {
+    long long size;
+    long long batches;
+    double sum_x, sum_y, sum_xx, sum_yy;
+    vector<BootstrapReplicate> bootstrap;    // Only filled with `--bootstrap`.
+    vector<Checkpoint> checkpoints;          // Only filled with `--checkpoints`.
+};
+
+/*  Cumulative probabilities P(X <= w) of a Poisson(1) distributed X, scaled to 2^32, while they are below 2^32 - 1.
+    The last entry is 2^32, which no 32-bit draw reaches.
+*/
+vector<uint64_t> poisson_one_thresholds() {
+    vector<uint64_t> thresholds;
+    double p = exp(-1.0), cdf = p;
+    for (int w = 1; cdf * 4294967296.0 < 4294967295.0; w++) {
+        thresholds.push_back(static_cast<uint64_t>(cdf * 4294967296.0));
+        p /= w;
+        cdf += p;
     }
-    if (s <=0) {
-        cerr << "Number of simulations must be positive."<< endl;
-        abort();
+    thresholds.push_back(1ULL << 32);
+    return thresholds;
+}
+
+const vector<uint64_t> POISSON_ONE_THRESHOLDS = poisson_one_thresholds();
+
+/*  Function to draw a Poisson(1) distributed weight from a single 32-bit draw.
+    Methodology:
+    - The draw is compared against the scaled cumulative probabilities in turn.
+      Most weights are 0, 1 or 2, so this takes about 2 comparisons instead of the several draws of `poisson_distribution`.
+*/
+inline int poisson_one(mt19937& gen) {
+    uint64_t u = gen();
+    int w = 0;
+    while (u >= POISSON_ONE_THRESHOLDS[w]) w++;
+    return w;
+}
+
+// Default number of games per batch. The geometric engine only spends work on won games, so its batches hold about `BATCH_DEFAULT_WINS` won games instead.
+const long long BATCH_DEFAULT_GAMES = 1024;
+const double BATCH_DEFAULT_WINS = 64;
+
+/*  Collects the wins of the games numbered [first, first + count) into `moments`, batch by batch.
+    - Wins must be added in increasing order of their game. Batches without wins need no calls, so sparse engines only pay per win.
+    - `finish()` adds the last batch.
+    - With `--checkpoints`, the wins are also added to the checkpoint that ends their stretch of games. Every `add()` must lie within one stretch.
+    - With `--bootstrap`, the part of every batch within the range is a resampling unit. Each replicate gives it a Poisson(1) weight
+      and adds the weighted games and wins. The batches skipped without wins only add games, and `j` of them together get a Poisson(j) weight.
+*/
+struct BatchAccumulator {
+    BatchMoments& moments;
+    long long size, first, end;
+    long long batch_lo, batch_hi;            // Games of the current batch.
+    long long stay_cnt, switch_cnt;
+    size_t segment;                          // Checkpoint that ends the current stretch of games.
+    long long segment_hi;                    // Its number of games, or LLONG_MAX after the last checkpoint.
+    long long segment_stay, segment_switch;
+
+    void next_segment(long long game) {
+        vector<Checkpoint>& checkpoints = moments.checkpoints;
+        if (segment < checkpoints.size()) {
+            checkpoints[segment].stay_cnt += segment_stay;
+            checkpoints[segment].switch_cnt += segment_switch;
+        }
+        segment_stay = segment_switch = 0;
+        while (segment < checkpoints.size() && checkpoints[segment].games <= game) segment++;
+        segment_hi = segment < checkpoints.size() ? checkpoints[segment].games : LLONG_MAX;
     }
-    cout << "Simulation Results" << endl;
-    simulate(n, k, s);
+
+    void resample(long long lo, long long hi, long long stay_wins, long long switch_wins) {
+        if (hi <= lo) return;
+        vector<BootstrapReplicate>& replicates = moments.bootstrap;
+        mt19937& gen = rng;
+        for (size_t r = 0; r < replicates.size(); r++) {
+            int w = poisson_one(gen);
+            replicates[r].games += w * (hi - lo);
+            replicates[r].stay_cnt += w * stay_wins;
+            replicates[r].switch_cnt += w * switch_wins;
+        }
+    }
+
+    // The games [lo, hi) were all lost: a partial batch at either end, and whole batches in between.
+    void resample_lost(long long lo, long long hi) {
+        if (hi <= lo || moments.bootstrap.empty()) return;
+        long long head_end = min(hi, (lo + size - 1) / size * size);
+        long long tail_lo = max(head_end, hi / size * size);
+        resample(lo, head_end, 0, 0);
+        resample(tail_lo, hi, 0, 0);
+        long long whole = (tail_lo - head_end) / size;
+        if (whole == 0) return;
+        poisson_distribution<long long> weight(whole);
+        for (size_t r = 0; r < moments.bootstrap.size(); r++) moments.bootstrap[r].games += weight(rng) * size;
+    }
+
+    void flush() {
+        if (!moments.bootstrap.empty()) resample(max(batch_lo, first), min(batch_hi, end), stay_cnt, switch_cnt);
+        if (batch_lo < first || batch_hi > end) return;
+        double x = stay_cnt;
+        double y = switch_cnt;
+        moments.sum_x += x;
+        moments.sum_y += y;
+        moments.sum_xx += x * x;
+        moments.sum_yy += y * y;
+    }
+
+    BatchAccumulator(BatchMoments& moments, long long first, long long count)
+        : moments(moments), size(moments.size), first(first), end(first + count), batch_lo(0), batch_hi(0), stay_cnt(0), switch_cnt(0),
+          segment(0), segment_hi(0), segment_stay(0), segment_switch(0) {
+        moments.batches += max(0LL, end / size - (first + size - 1) / size);
+        next_segment(first);
+    }
+
+    void add(long long game, long long stay_wins, long long switch_wins) {
+        if (game >= batch_hi) {
+            flush();
+            // Wins are usually in the next batch, which saves a division.
+            long long lo = game < batch_hi + size ? batch_hi : game - game % size;
+            resample_lost(max(batch_hi, first), lo);
+            batch_lo = lo;
+            batch_hi = batch_lo + size;
+            stay_cnt = switch_cnt = 0;
+        }
+        stay_cnt += stay_wins;
+        switch_cnt += switch_wins;
+        if (game >= segment_hi) next_segment(game);
+        segment_stay += stay_wins;
+        segment_switch += switch_wins;
+    }
+
+    void finish() {
+        next_segment(end);
+        flush();
+        resample_lost(max(batch_hi, first), end);
+    }
+};
+
+/*  Function to simulate the games numbered [first, first + count) at once, only spending work on the games that are won.
+    Return Type:
+    - The number of games won by staying and by switching are added to `stay_cnt` and `switch_cnt`.
+    - If `trace` is given, the index (0-based) and scenario of every won game are written to it, one game per line.
+    - Every won game is added to its batch in `batch_moments`.
+
+    Methodology:
+    - As in `scenario_statistics_optimal()`, a game is won by staying with probability 1/n and by switching with probability (n-1)/n * 1/R, where `R = n-k-1`.
+      The two cases never happen together, so a game is won at all with probability `q = 1/n + (n-1)/(n*R) = (R+n-1)/(n*R)`.
+    - Games are independent, so the number of lost games before the next won one follows a geometric distribution with parameter `q`.
+      We draw that gap and jump straight to the next won game. The distribution is memoryless, so a new range can start with a fresh gap.
+    - Given that a game is won, it is won by staying with probability `(1/n) / q = R/(R+n-1)`. This is decided exactly by an integer draw.
+
+    Time Complexity:
+    - O(number of won games), which is about `count * q` (tiny when n is large).
+*/
+void simulate_geometric(int n, int k, long long first, long long count, long long& stay_cnt, long long& switch_cnt, ostream* trace, BatchMoments& batch_moments) {
+    long long remaining = n - k - 1;
+    long long win_ways = remaining + n - 1;
+    double q = static_cast<double>(win_ways) / (static_cast<double>(n) * remaining);
+    uniform_int_distribution<long long> scenario(0, win_ways - 1);
+    BatchAccumulator batches(batch_moments, first, count);
+    auto win = [&](long long i) {
+        bool stay_success = scenario(rng) < remaining;
+        if (stay_success) stay_cnt++;
+        else switch_cnt++;
+        if (trace) *trace << first + i << ' ' << (stay_success ? 1 : 2) << '\n';
+        batches.add(first + i, stay_success, !stay_success);
+    };
+    if (q >= 1) {
+        // With only one door left to switch to, every game is won, and a geometric distribution needs q < 1.
+        for (long long i = 0; i < count; i++) win(i);
+    }
+    else {
+        geometric_distribution<long long> gap(q);
+        for (long long i = gap(rng); i < count; i += 1 + gap(rng)) win(i);
+    }
+    batches.finish();
+}
+
+enum Sampling { SAMPLING_IID, SAMPLING_QMC, SAMPLING_STRATIFIED };
+
+enum Engine { ENGINE_OPTIMAL, ENGINE_RANDOMISED, ENGINE_GEOMETRIC, ENGINE_EXACT, ENGINE_ENUMERATE, ENGINE_IMPORTANCE };
+
+/*  Function to look up the engine called `name`. Return Type: false if there is no such engine. */
+bool parse_engine(const string& name, Engine& engine) {
+    if (name == "optimal") engine = ENGINE_OPTIMAL;
+    else if (name == "randomised") engine = ENGINE_RANDOMISED;
+    else if (name == "geometric") engine = ENGINE_GEOMETRIC;
+    else if (name == "exact") engine = ENGINE_EXACT;
+    else if (name == "enumerate") engine = ENGINE_ENUMERATE;
+    else if (name == "importance") engine = ENGINE_IMPORTANCE;
+    else return false;
+    return true;
+}
+
+/*  Settings of a simulation run, as given on the command line. */
+struct SimulationConfig {
+    int n;                                   // Number of doors.
+    int k;                                   // Number of doors opened by the host.
+    long long simulations;                   // Number of simulations.
+    Engine engine;                           // Which routine simulates the games.
+    int threads;                             // Number of threads.
+    string trace;                            // File to list the won games in, if not empty.
+    string outcomes;                         // File to write the outcome of every game to, if not empty.
+    bool verify;                             // Whether to check the results against the exact probabilities.
+    double target_ci;                        // Half-width both 95% confidence intervals should reach, or 0 to run all simulations.
+    bool decide;                             // Whether to stop as soon as it is settled whether switching is better.
+    double error_rate;                       // Error probability allowed to `--decide`.
+    double indifference;                     // Distance of the share of switch wins from 1/2 that `--decide` must detect.
+    string variance_reduction;               // none, antithetic, control or both.
+    bool antithetic;                         // Whether games are simulated in antithetic pairs.
+    bool control_variate;                    // Whether the switch estimate is corrected with the known stay win rate.
+    Sampling sampling;                       // How the draws of the optimal engine are made.
+    string sampling_name;                    // iid, qmc or stratified.
+    int replicates;                          // Number of independently randomized point sets, with qmc or stratified sampling.
+    double importance_bias;                  // Share of games forced onto the rare events by the importance engine.
+    long long batch_size;                    // Number of games per batch of the batch means standard errors.
+    int bootstrap;                           // Number of Poisson bootstrap replicates, or 0.
+    vector<long long> checkpoints;           // Numbers of games at which the running win rates are reported, in increasing order.
+    double time_limit;                       // Wall-clock seconds the games may run for, or 0 for no limit.
+    chrono::steady_clock::time_point deadline; // When the time limit runs out.
+    double progress;                         // Seconds between progress lines, or 0 for none.
+    bool seeded;                             // Whether `--seed` was given, so that the games only depend on `seed`.
+    uint64_t seed;                           // Seed of the games of a seeded run.
+    string checkpoint_file;                  // File to save the state of the run to, if not empty.
+    double checkpoint_every;                 // Seconds between saves of the state of the run.
+    string resume;                           // File to continue a saved run from, if not empty.
+    string cache;                            // Result cache file, if not empty.
+    int shard, shards;                       // This run simulates shard `shard` of `shards`, if `shards` > 0.
+    string shard_file;                       // File the partial results of a shard are written to.
+    string work_dir;                         // Directory of a shared work queue, if not empty.
+    int chunks;                              // Number of chunks the work queue splits the games into.
+    double lease_timeout;                    // Seconds after which a lease on a chunk that is not renewed may be taken over.
+    int processes;                           // Number of worker processes to fork, or 0 to simulate in this process.
+    bool race;                               // Whether to race all the numbers of opened doors instead of simulating `k`.
+    double door_cost;                        // Cost of every door the host opens, as a share of the prize, in a race.
+    double target_rel_error;                 // Relative standard error every cell of a sweep should reach.
+};
+
+/*  Function to run a single simulation with the routine chosen in `cfg`. */
+pair<bool, bool> scenario_statistics(const SimulationConfig& cfg) {
+    if (cfg.engine == ENGINE_OPTIMAL) return scenario_statistics_optimal(cfg.n, cfg.k);
+    if (cfg.engine == ENGINE_IMPORTANCE) return scenario_statistics_importance(cfg.n, cfg.k, cfg.importance_bias);
+    if (cfg.threads > 1 && cfg.n >= PARALLEL_MIN_DOORS) return scenario_statistics_parallel(cfg.n, cfg.k, cfg.threads);
+    return scenario_statistics_randomised(cfg.n, cfg.k);
+}
+
+/*  Sums over the sampling units of a run with `--variance_reduction`: single games, or antithetic pairs of games.
+    `x` is the share of the unit's games won by staying and `y` the share won by switching.
+*/
+struct UnitMoments {
+    long long units;
+    double sum_x, sum_y, sum_xx, sum_yy, sum_xy;
+};
+
+/*  Totals of a simulation run. */
+struct Tally {
+    long long simulations;
+    long long stay_cnt;
+    long long switch_cnt;
+    UnitMoments moments;                     // Only filled with `--variance_reduction`.
+    BatchMoments batches;
+};
+
+/*  Function to set up a tally with no games, for the batch size, bootstrap replicates and checkpoints of `cfg`. */
+Tally empty_tally(const SimulationConfig& cfg) {
+    Tally tally = Tally();
+    tally.batches.size = cfg.batch_size;
+    tally.batches.bootstrap.resize(cfg.bootstrap, BootstrapReplicate());
+    for (size_t c = 0; c < cfg.checkpoints.size(); c++) {
+        Checkpoint checkpoint = {cfg.checkpoints[c], 0, 0};
+        tally.batches.checkpoints.push_back(checkpoint);
+    }
+    return tally;
+}
+
+/*  Function to find what a single stay or switch win counts for: 1, or the likelihood ratio of `importance_weights()` with the importance engine. */
+void hit_weights(const SimulationConfig& cfg, double weights[2]) {
+    weights[0] = weights[1] = 1;
+    if (cfg.engine == ENGINE_IMPORTANCE) {
+        pair<double, double> w = importance_weights(cfg.n, cfg.k, cfg.importance_bias);
+        weights[0] = w.first;
+        weights[1] = w.second;
+    }
+}
+
+/*  Function to add the totals of `from` to `into`. */
+void merge_tally(Tally& into, const Tally& from) {
+    into.simulations += from.simulations;
+    into.stay_cnt += from.stay_cnt;
+    into.switch_cnt += from.switch_cnt;
+    into.moments.units += from.moments.units;
+    into.moments.sum_x += from.moments.sum_x;
+    into.moments.sum_y += from.moments.sum_y;
+    into.moments.sum_xx += from.moments.sum_xx;
+    into.moments.sum_yy += from.moments.sum_yy;
+    into.moments.sum_xy += from.moments.sum_xy;
+    into.batches.batches += from.batches.batches;
+    into.batches.sum_x += from.batches.sum_x;
+    into.batches.sum_y += from.batches.sum_y;
+    into.batches.sum_xx += from.batches.sum_xx;
+    into.batches.sum_yy += from.batches.sum_yy;
+    for (size_t c = 0; c < into.batches.checkpoints.size(); c++) {
+        into.batches.checkpoints[c].stay_cnt += from.batches.checkpoints[c].stay_cnt;
+        into.batches.checkpoints[c].switch_cnt += from.batches.checkpoints[c].switch_cnt;
+    }
+    for (size_t r = 0; r < into.batches.bootstrap.size(); r++) {
+        into.batches.bootstrap[r].games += from.batches.bootstrap[r].games;
+        into.batches.bootstrap[r].stay_cnt += from.batches.bootstrap[r].stay_cnt;
+        into.batches.bootstrap[r].switch_cnt += from.batches.bootstrap[r].switch_cnt;
+    }
+}
+
+// Number of games whose outcomes are buffered before they are written to the `--outcomes` file.
+const size_t OUTCOME_BLOCK = 1 << 16;
+
+/*  Function to simulate the games numbered [first, first + count) with the engine of `cfg`, and add them to `tally`.
+    - If `trace` is given, the index and scenario of every won game are written to it, one game per line.
+    - If `outcomes` is given, the outcome of every game is written to it, one byte per game. The outcomes are produced in blocks of `OUTCOME_BLOCK` games.
+      For the optimal engine a block is filled by the single-draw `scenario_outcomes()`.
+    - Only the geometric engine adds its batches to `tally`, the others are called once per batch by `run_batches()`.
+*/
+void run_block(const SimulationConfig& cfg, long long first, long long count, Tally& tally, ostream* trace, ostream* outcomes) {
+    tally.simulations += count;
+    if (cfg.antithetic || cfg.control_variate) {
+        // `count` is even with antithetic pairs.
+        UnitMoments& m = tally.moments;
+        int unit_games = cfg.antithetic ? 2 : 1;
+        for (long long i = 0; i < count; i += unit_games) {
+            pair<bool, bool> results[2];
+            if (cfg.antithetic) {
+                pair<pair<bool, bool>, pair<bool, bool> > games = scenario_statistics_antithetic(cfg.n, cfg.k);
+                results[0] = games.first;
+                results[1] = games.second;
+            }
+            else results[0] = scenario_statistics_optimal(cfg.n, cfg.k);
+
+            int stay_wins = 0, switch_wins = 0;
+            for (int g = 0; g < unit_games; g++) {
+                stay_wins += results[g].first;
+                switch_wins += results[g].second;
+                if (trace && (results[g].first || results[g].second)) *trace << first + i + g << ' ' << (results[g].first ? 1 : 2) << '\n';
+            }
+            tally.stay_cnt += stay_wins;
+            tally.switch_cnt += switch_wins;
+            double x = static_cast<double>(stay_wins) / unit_games;
+            double y = static_cast<double>(switch_wins) / unit_games;
+            m.units++;
+            m.sum_x += x;
+            m.sum_y += y;
+            m.sum_xx += x * x;
+            m.sum_yy += y * y;
+            m.sum_xy += x * y;
+        }
+    }
+    else if (cfg.engine == ENGINE_GEOMETRIC) {
+        simulate_geometric(cfg.n, cfg.k, first, count, tally.stay_cnt, tally.switch_cnt, trace, tally.batches);
+    }
+    else if (outcomes) {
+        OutcomeKernel kernel(cfg.n, cfg.k);
+        vector<uint8_t> block(min<long long>(OUTCOME_BLOCK, count));
+        for (long long done = 0; done < count; done += OUTCOME_BLOCK) {
+            size_t block_cnt = min<long long>(OUTCOME_BLOCK, count - done);
+            if (cfg.engine == ENGINE_OPTIMAL) scenario_outcomes(kernel, block.data(), block_cnt);
+            else for (size_t i = 0; i < block_cnt; i++) {
+                pair<bool, bool> results = scenario_statistics(cfg);
+                block[i] = results.first ? OUTCOME_STAY : results.second ? OUTCOME_SWITCH : OUTCOME_LOST;
+            }
+            for (size_t i = 0; i < block_cnt; i++) {
+                tally.stay_cnt += block[i] == OUTCOME_STAY;
+                tally.switch_cnt += block[i] == OUTCOME_SWITCH;
+                if (trace && block[i] != OUTCOME_LOST) *trace << first + done + i << ' ' << static_cast<int>(block[i]) << '\n';
+            }
+            outcomes->write(reinterpret_cast<const char*>(block.data()), block_cnt);
+        }
+    }
+    else for (long long i = 0; i < count; i++) {
+        pair<bool, bool> results = scenario_statistics(cfg);
+
+        // Counting scenario 1 cases.
+        tally.stay_cnt += results.first;
+        // Counting scenario 2 cases.
+        tally.switch_cnt += results.second;
+        if (trace && (results.first || results.second)) *trace << first + i << ' ' << (results.first ? 1 : 2) << '\n';
+    }
+}
+
+/*  Function to simulate the games numbered [first, first + count) on the calling thread, and add them and their batches to `tally`.
+    - The range is cut at the batch boundaries and checkpoints, so that the counts of every batch can be read off the tally.
+      The geometric engine skips most games, so it is run on the whole range and adds its wins itself.
+*/
+void run_batches(const SimulationConfig& cfg, long long first, long long count, Tally& tally, ostream* trace, ostream* outcomes) {
+    if (cfg.engine == ENGINE_GEOMETRIC) {
+        run_block(cfg, first, count, tally, trace, outcomes);
+        return;
+    }
+    BatchAccumulator batches(tally.batches, first, count);
+    const vector<Checkpoint>& checkpoints = tally.batches.checkpoints;
+    size_t next_checkpoint = 0;
+    for (long long lo = first, hi; lo < first + count; lo = hi) {
+        hi = min(first + count, (lo / cfg.batch_size + 1) * cfg.batch_size);
+        while (next_checkpoint < checkpoints.size() && checkpoints[next_checkpoint].games <= lo) next_checkpoint++;
+        if (next_checkpoint < checkpoints.size()) hi = min(hi, checkpoints[next_checkpoint].games);
+        long long stay_cnt = tally.stay_cnt;
+        long long switch_cnt = tally.switch_cnt;
+        run_block(cfg, lo, hi - lo, tally, trace, outcomes);
+        batches.add(lo, tally.stay_cnt - stay_cnt, tally.switch_cnt - switch_cnt);
+    }
+    batches.finish();
+}
+
+// A block of a seeded run is about this much work: the number of games, or of doors for the randomised engine.
+const long long SEEDED_BLOCK_WORK = 1 << 16;
+
+/*  Function to find the number of games per block of a seeded run. It is a whole number of batches, and does not depend on the number of threads. */
+long long seeded_block_games(const SimulationConfig& cfg) {
+    long long games = max(1LL, SEEDED_BLOCK_WORK / (cfg.engine == ENGINE_RANDOMISED ? cfg.n : 1));
+    return (games + cfg.batch_size - 1) / cfg.batch_size * cfg.batch_size;
+}
+
+/*  Function to seed the calling thread's generator for the block of games starting at game `first` of a run with seed `seed`.
+    Every block gets its own stream, so the games of a seeded run do not depend on which thread simulates them, or on when the run was resumed.
+*/
+void seed_block(uint64_t seed, long long first) {
+    seed_seq sequence = {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32),
+                         static_cast<uint32_t>(first), static_cast<uint32_t>(static_cast<uint64_t>(first) >> 32)};
+    rng.seed(sequence);
+}
+
+// Every thread keeps doubling its blocks of games while a block takes less than this many seconds.
+const double TIME_BLOCK_SECONDS = 0.01;
+// A thread's first block is a whole batch if that is at most this much work: games, or doors for the randomised engine.
+const long long FIRST_BLOCK_WORK = 1 << 22;
+
+// Set by the signal handlers. The worker threads check them only between blocks of games.
+atomic<bool> stop_requested(false);
+atomic<bool> snapshot_requested(false);
+atomic<int> stop_signal(0);                  // The signal that stopped the run, for the exit status.
+
+/*  Running totals of the games one thread has finished, for the progress monitor.
+    Each slot has a single writer, which stores new totals after every block, so no read-modify-write atomics are needed.
+*/
+struct alignas(64) ProgressSlot {                    // One cache line per thread.
+    atomic<long long> simulations, stay_cnt, switch_cnt;
+};
+
+// The progress slots of the running simulation, one per thread, or NULL if nobody is watching.
+// Before C++17, `new` ignores the alignment of the slots, so they are placed in their memory by hand.
+vector<char> progress_memory;
+ProgressSlot* progress_slots = NULL;
+
+/*  Function to simulate the games numbered [first, first + count) with `cfg.threads` threads, and add them to `tally`.
+    - Every thread claims blocks of games in order from a shared counter, and simulates them into its own tally, with its own generator
+      seeded from the main thread's. The tallies are merged at the end.
+    - The clock and the stop request are only checked before claiming the next block. A claimed block is always finished,
+      so even a run stopped by `--time_limit` or Ctrl-C has done exactly the games [first, first + games done), whichever thread did them.
+    - A thread's first block is a whole batch, or a single game (or antithetic pair) if a batch is more than `FIRST_BLOCK_WORK`,
+      and its blocks double while they take less than `TIME_BLOCK_SECONDS`.
+      So slow engines still stop soon after the deadline, and fast ones only read the clock every few milliseconds.
+      A batch split between blocks is left out of the batch means, so starting with whole batches keeps every batch of a cheap run.
+    - Blocks end on batch boundaries where they can, and blocks smaller than a batch are kept within one batch,
+      so that batches are mostly simulated by a single thread.
+    - After every block, a thread publishes its totals to its progress slot, if there are any.
+    - A seeded run instead uses fixed blocks of `seeded_block_games()`, each with its own generator from `seed_block()`.
+      Every count is then an integer sum over the blocks, so the totals are the same for any number of threads.
+    - Traces and outcome files are written in game order, and the parallel engine already uses the threads within each game,
+      so those runs stay on one thread.
+    - With `shared_next`, the threads claim their blocks from that counter instead, which starts at `first` and may be shared with other processes.
+*/
+void run_games(const SimulationConfig& cfg, long long first, long long count, Tally& tally, ostream* trace, ostream* outcomes, atomic<long long>* shared_next = NULL) {
+    bool parallel_games = cfg.engine == ENGINE_RANDOMISED && cfg.n >= PARALLEL_MIN_DOORS;
+    int threads = trace || outcomes || parallel_games ? 1 : cfg.threads;
+    long long size = cfg.batch_size;
+    long long end = first + count;
+    atomic<long long> own_next(first);
+    atomic<long long>& next_game = shared_next ? *shared_next : own_next;
+    long long seeded_block = cfg.seeded ? seeded_block_games(cfg) : 0;
+    vector<unsigned> seeds(threads);
+    for (int t = 0; t < threads && !cfg.seeded; t++) seeds[t] = rng();
+    vector<Tally> partial(threads, empty_tally(cfg));
+    auto work = [&](int t, long long, long long) {
+        if (threads > 1 && !cfg.seeded) rng.seed(seeds[t]);
+        ProgressSlot* slot = progress_slots ? &progress_slots[t] : NULL;
+        long long block = cfg.antithetic ? 2 : 1;        // Antithetic pairs are never split.
+        if (size <= FIRST_BLOCK_WORK / (cfg.engine == ENGINE_RANDOMISED ? cfg.n : 1)) block = size;
+        while (!stop_requested && chrono::steady_clock::now() < cfg.deadline) {
+            long long lo = next_game.load(), hi;
+            do {
+                hi = lo + min(block, end - lo);
+                if (cfg.seeded) hi = min(end, (lo / seeded_block + 1) * seeded_block);
+                else if (hi < end && hi / size * size > lo) hi = hi / size * size;
+                else if (block < size) hi = min(hi, (lo / size + 1) * size);
+            } while (lo < end && !next_game.compare_exchange_weak(lo, hi));
+            if (lo >= end) break;
+            if (cfg.seeded) seed_block(cfg.seed, lo);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            long long simulations = partial[t].simulations;
+            long long stay_cnt = partial[t].stay_cnt;
+            long long switch_cnt = partial[t].switch_cnt;
+            run_batches(cfg, lo, hi - lo, partial[t], trace, outcomes);
+            if (chrono::duration<double>(chrono::steady_clock::now() - start).count() < TIME_BLOCK_SECONDS && block < count) block *= 2;
+            if (slot) {
+                slot->simulations.store(slot->simulations.load(memory_order_relaxed) + partial[t].simulations - simulations, memory_order_relaxed);
+                slot->stay_cnt.store(slot->stay_cnt.load(memory_order_relaxed) + partial[t].stay_cnt - stay_cnt, memory_order_relaxed);
+                slot->switch_cnt.store(slot->switch_cnt.load(memory_order_relaxed) + partial[t].switch_cnt - switch_cnt, memory_order_relaxed);
+            }
+        }
+    };
+    if (threads == 1) work(0, 0, 0);
+    else parallel_slices(threads, 0, work);
+    for (int t = 0; t < threads; t++) merge_tally(tally, partial[t]);
+}
+
+// Ctrl-C (or SIGTERM) stops the workers after their current blocks. A second one kills the program as usual.
+void handle_interrupt(int signal_number) {
+    stop_signal = signal_number;
+    stop_requested = true;
+    signal(signal_number, SIG_DFL);
+}
+
+void handle_snapshot(int) {
+    snapshot_requested = true;
+}
+
+// How often the progress monitor looks for a snapshot request, in seconds.
+const double MONITOR_POLL_SECONDS = 0.05;
+
+/*  Function to watch a running simulation from its own thread, until `done` is set.
+    - Every `cfg.progress` seconds, and whenever SIGUSR1 asks for a snapshot, it adds up the `threads` progress slots
+      and prints the games done so far, the rate, the estimated time left and the current win rates to cerr.
+    - The slots are only updated between blocks, so the totals lag the workers by at most one block per thread.
+    - The estimated time left comes from `cfg.simulations` and the time limit, whichever ends the run first. Adaptive runs without either have none.
+*/
+void monitor_progress(const SimulationConfig& cfg, int threads, mutex& lock, condition_variable& wake, const bool& done) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    chrono::steady_clock::time_point next_report = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(cfg.progress));
+    double weights[2];
+    hit_weights(cfg, weights);
+    unique_lock<mutex> guard(lock);
+    while (!wake.wait_for(guard, chrono::duration<double>(MONITOR_POLL_SECONDS), [&] { return done; })) {
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        bool snapshot = snapshot_requested.exchange(false);
+        bool report = cfg.progress > 0 && now >= next_report;
+        if (!snapshot && !report) continue;
+        if (report) next_report += chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(cfg.progress));
+
+        long long simulations = 0, stay_cnt = 0, switch_cnt = 0;
+        for (int t = 0; t < threads; t++) {
+            simulations += progress_slots[t].simulations.load(memory_order_relaxed);
+            stay_cnt += progress_slots[t].stay_cnt.load(memory_order_relaxed);
+            switch_cnt += progress_slots[t].switch_cnt.load(memory_order_relaxed);
+        }
+        double seconds = chrono::duration<double>(now - start).count();
+        double rate = simulations / seconds;
+        double eta = INFINITY;
+        if (cfg.simulations != LLONG_MAX && rate > 0) eta = (cfg.simulations - simulations) / rate;
+        if (cfg.time_limit > 0) eta = min(eta, max(0.0, chrono::duration<double>(cfg.deadline - now).count()));
+        cerr << (snapshot ? "Snapshot: " : "Progress: ") << simulations << " simulations in " << seconds << " seconds (" << rate << " per second";
+        if (eta != INFINITY) cerr << ", about " << eta << " seconds left";
+        cerr << ")";
+        if (simulations > 0) {
+            cerr << ", staying wins " << weights[0] * stay_cnt / simulations * 100 << "%, switching wins " << weights[1] * switch_cnt / simulations * 100 << "%";
+        }
+        cerr << "." << endl;
+    }
+}
+
+// z-value of the two-sided 95% confidence intervals.
+const double CONFIDENCE_Z = 1.959963984540054;
+// Smallest number of games simulated between two checks of `--target_ci` or `--decide`.
+// Later batches are 1/16 of the games so far, so at most ~6% extra games are run.
+const long long ADAPTIVE_MIN_BATCH = 64;
+
+/*  Function to compute the Wilson score interval of a win rate.
+    Return Type:
+    - It returns the interval `<low, high>` that contains the true win rate with the confidence of `z`.
+    - Unlike the plain `p +- z*sqrt(p(1-p)/N)`, it does not collapse to a single point when no game (or every game) was won.
+*/
+pair<double, double> wilson_interval(long long wins, long long simulations, double z) {
+    double N = simulations;
+    double p = wins / N;
+    double z2 = z * z;
+    double center = (p + z2 / (2 * N)) / (1 + z2 / N);
+    double half_width = z / (1 + z2 / N) * sqrt(p * (1 - p) / N + z2 / (4 * N * N));
+    return pair<double, double>{max(0.0, center - half_width), min(1.0, center + half_width)};
+}
+
+/*  Direction numbers of the first three dimensions of the Sobol sequence, as 64-bit binary fractions.
+    - Dimension 1 is the van der Corput sequence, `v_j = 2^-j`.
+    - Dimension 2 uses the primitive polynomial x+1, so `v_j = v_{j-1} ^ (v_{j-1} >> 1)`.
+    - Dimension 3 uses x^2+x+1 with initial numbers m = 1, 3, so `v_j = v_{j-1} ^ v_{j-2} ^ (v_{j-2} >> 2)`.
+*/
+struct SobolDirections {
+    uint64_t v[3][64];
+
+    SobolDirections() {
+        for (int j = 0; j < 64; j++) v[0][j] = 1ULL << (63 - j);
+        v[1][0] = 1ULL << 63;
+        for (int j = 1; j < 64; j++) v[1][j] = v[1][j-1] ^ (v[1][j-1] >> 1);
+        v[2][0] = 1ULL << 63;
+        v[2][1] = 3ULL << 62;
+        for (int j = 2; j < 64; j++) v[2][j] = v[2][j-1] ^ v[2][j-2] ^ (v[2][j-2] >> 2);
+    }
+};
+
+/*  Function to scale a uniform 64-bit binary fraction `x` to a door (or dice value) in [1, m]. */
+inline int scale_draw(uint64_t x, int m) {
+    return static_cast<int>((static_cast<uint128>(x) * m) >> 64) + 1;
+}
+
+/*  Function to simulate the games [lo, hi) of one randomized Sobol point set.
+    Methodology:
+    - Game i uses point `i` of the three-dimensional Sobol sequence (in Gray code order) for `car_idx`, `player_idx` and `dice_roll`,
+      XORed with the replicate's random `shift`. The shifted points are still spread evenly, but every single point is uniform,
+      so every replicate gives an unbiased estimate.
+    - The second coordinate gives the player's door as an offset from the car's, so that staying wins when it falls in [0, 1/n).
+      Taken as two separate doors, staying would win on the diagonal of a two-dimensional grid, which a Sobol set does not cover
+      any more evenly than random points, and for a large n it does much worse.
+    - Consecutive points in Gray code order differ by one direction number, so after the first point each game costs three XORs.
+*/
+void simulate_qmc_range(int n, int k, long long lo, long long hi, const uint64_t shift[3], long long& stay_cnt, long long& switch_cnt) {
+    static const SobolDirections sobol;
+    int remaining = n - k - 1;
+    uint64_t x[3] = {shift[0], shift[1], shift[2]};
+    uint64_t gray = lo ^ (lo >> 1);
+    for (int j = 0; j < 64; j++) {
+        if (gray >> j & 1) for (int d = 0; d < 3; d++) x[d] ^= sobol.v[d][j];
+    }
+    for (long long i = lo; i < hi; i++) {
+        int car_idx = scale_draw(x[0], n);
+        int player_idx = (car_idx - 1 + scale_draw(x[1], n) - 1) % n + 1;
+        int dice_roll = scale_draw(x[2], remaining);
+        stay_cnt += car_idx == player_idx;
+        switch_cnt += car_idx != player_idx && dice_roll == 1;
+
+        int j = __builtin_ctzll(i + 1);
+        for (int d = 0; d < 3; d++) x[d] ^= sobol.v[d][j];
+    }
+}
+
+/*  Function to simulate the games [lo, hi) of a stratified sample of `count` games.
+    Methodology:
+    - As shown for `scenario_outcomes()`, a game is fully described by one draw u, uniform in [0, T) with `T = n*R`,
+      which is a relabelling of the three draws of `scenario_statistics_optimal()`.
+    - The range [0, T) is cut into `count` strata of equal width `T/count`, and game i draws u uniformly from stratum i:
+      `u = floor((i*T + w) / count)` with w uniform in [0, T). This is exact in 128-bit arithmetic, and u is uniform over [0, T) for a random stratum.
+    - Only the two strata that contain a threshold of `OutcomeKernel` can go either way, so the estimate varies very little.
+*/
+void simulate_stratified_range(int n, int k, long long count, long long lo, long long hi, mt19937_64& local_rng, long long& stay_cnt, long long& switch_cnt) {
+    OutcomeKernel kernel(n, k);
+    uint64_t T = static_cast<uint64_t>(n) * (n - k - 1);
+    uniform_int_distribution<uint64_t> offset(0, T - 1);
+    for (long long i = lo; i < hi; i++) {
+        uint64_t u = static_cast<uint64_t>((static_cast<uint128>(i) * T + offset(local_rng)) / static_cast<uint64_t>(count));
+        stay_cnt += u < kernel.stay_ways;
+        switch_cnt += u - kernel.stay_ways < kernel.switch_ways;
+    }
+}
+
+/*  Function to simulate `cfg.simulations` games as `cfg.replicates` independently randomized point sets of `--sampling qmc` or `stratified`.
+    Return Type:
+    - The totals of all replicates are added to `tally`, and the totals of every replicate are returned.
+
+    Methodology:
+    - Every replicate is an unbiased estimate on its own, so the spread between replicates gives a valid standard error,
+      which i.i.d. error formulas would overstate for these point sets.
+    - The points of every replicate are split into one contiguous slice per thread.
+*/
+vector<Tally> simulate_replicates(const SimulationConfig& cfg, Tally& tally) {
+    vector<Tally> replicates;
+    for (int r = 0; r < cfg.replicates; r++) {
+        long long count = cfg.simulations / cfg.replicates + (r < cfg.simulations % cfg.replicates);
+        uint64_t shift[3];
+        for (int d = 0; d < 3; d++) shift[d] = uniform_int_distribution<uint64_t>()(rng);
+        vector<uint64_t> seeds(cfg.threads);
+        for (int t = 0; t < cfg.threads; t++) seeds[t] = uniform_int_distribution<uint64_t>()(rng);
+
+        vector<long long> stay_cnt(cfg.threads, 0), switch_cnt(cfg.threads, 0);
+        parallel_slices(cfg.threads, count, [&](int t, long long lo, long long hi) {
+            if (cfg.sampling == SAMPLING_QMC) simulate_qmc_range(cfg.n, cfg.k, lo, hi, shift, stay_cnt[t], switch_cnt[t]);
+            else {
+                mt19937_64 local_rng(seeds[t]);
+                simulate_stratified_range(cfg.n, cfg.k, count, lo, hi, local_rng, stay_cnt[t], switch_cnt[t]);
+            }
+        });
+        Tally replicate = Tally();
+        replicate.simulations = count;
+        for (int t = 0; t < cfg.threads; t++) {
+            replicate.stay_cnt += stay_cnt[t];
+            replicate.switch_cnt += switch_cnt[t];
+        }
+        tally.simulations += replicate.simulations;
+        tally.stay_cnt += replicate.stay_cnt;
+        tally.switch_cnt += replicate.switch_cnt;
+        replicates.push_back(replicate);
+    }
+    return replicates;
+}
+
+/*  Function to report the standard errors of a `--sampling qmc` or `stratified` run, from the spread of its replicates. */
+void report_replicates(const SimulationConfig& cfg, const Tally& tally, const vector<Tally>& replicates) {
+    int R = replicates.size();
+    if (R < 2) return;
+    for (int i = 0; i < 2; i++) {
+        double mean = static_cast<double>(i == 0 ? tally.stay_cnt : tally.switch_cnt) / tally.simulations;
+        double sum_sq = 0;
+        for (int r = 0; r < R; r++) {
+            double estimate = static_cast<double>(i == 0 ? replicates[r].stay_cnt : replicates[r].switch_cnt) / replicates[r].simulations;
+            sum_sq += (estimate - mean) * (estimate - mean);
+        }
+        double std_error = sqrt(sum_sq / (R - 1) / R);
+        double iid_std_error = sqrt(mean * (1 - mean) / tally.simulations);
+        cout << "Scenario " << i + 1 << " (" << cfg.sampling_name << "): standard error " << std_error * 100 << "% over " << R << " randomized replicates";
+        if (std_error > 0) cout << ", " << iid_std_error / std_error << "x smaller than with i.i.d. draws." << endl;
+        else cout << ", which all agree." << endl;
+    }
+}
+
+/*  Function to report the batch means standard errors of both win rates.
+    Methodology:
+    - The batches are independent, so the sample variance s^2 of the batch win rates estimates the variance of one batch.
+      A single game then has variance `size * s^2`, and the win rate of all the games has standard error sqrt(size * s^2 / simulations).
+    - This also holds when the games within a batch are correlated, like antithetic pairs, so it needs no knowledge of the engine.
+      Importance sampling hits are weighted as in `importance_estimates()`.
+*/
+void report_batch_means(const SimulationConfig& cfg, const Tally& tally) {
+    const BatchMoments& b = tally.batches;
+    if (b.batches < 2) {
+        cout << "Standard errors: fewer than 2 complete batches of " << b.size << " games, a smaller --batch_size is needed." << endl;
+        return;
+    }
+    double m = b.batches;
+    double size = b.size;
+    // Variances of the win rate of a batch.
+    double variances[2] = {(b.sum_xx - b.sum_x * b.sum_x / m) / (m - 1) / (size * size), (b.sum_yy - b.sum_y * b.sum_y / m) / (m - 1) / (size * size)};
+    double weights[2];
+    hit_weights(cfg, weights);
+    for (int i = 0; i < 2; i++) {
+        double std_error = weights[i] * sqrt(max(0.0, variances[i]) * b.size / tally.simulations);
+        cout << "Scenario " << i + 1 << ": standard error " << std_error * 100 << "% (batch means of " << b.batches << " batches of " << b.size << " games)." << endl;
+    }
+}
+
+// Two-sided coverage of the bootstrap intervals.
+const double BOOTSTRAP_COVERAGE = 0.95;
+
+/*  Function to look up the `q` quantile of the sorted `values`. */
+double sorted_quantile(const vector<double>& values, double q) {
+    return values[static_cast<size_t>(floor(q * (values.size() - 1) + 0.5))];
+}
+
+/*  Function to report the 95% Poisson bootstrap intervals of both win rates and of the ratio of switch wins to stay wins.
+    Methodology:
+    - Every replicate holds the games and wins of the run, each batch weighted by its Poisson(1) weight.
+      Its win rates are `wins / games`, and its ratio is `switch_cnt / stay_cnt`.
+    - The intervals are the 2.5% and 97.5% quantiles of the replicate values (percentile bootstrap).
+      Importance sampling hits are weighted as in `importance_estimates()`.
+*/
+void report_bootstrap(const SimulationConfig& cfg, const Tally& tally) {
+    const vector<BootstrapReplicate>& replicates = tally.batches.bootstrap;
+    double weights[2];
+    hit_weights(cfg, weights);
+    vector<double> values[3];
+    for (size_t r = 0; r < replicates.size(); r++) {
+        // A replicate that left out every batch holds no games at all.
+        const BootstrapReplicate& b = replicates[r];
+        if (b.games == 0) continue;
+        double stay = weights[0] * b.stay_cnt, switched = weights[1] * b.switch_cnt;
+        values[0].push_back(stay / b.games);
+        values[1].push_back(switched / b.games);
+        values[2].push_back(stay > 0 ? switched / stay : INFINITY);
+    }
+    if (values[0].size() < 2) {
+        cout << "Bootstrap intervals: fewer than 2 replicates with any games, a smaller --batch_size is needed." << endl;
+        return;
+    }
+    double lo_q = (1 - BOOTSTRAP_COVERAGE) / 2, hi_q = 1 - lo_q;
+    for (int i = 0; i < 3; i++) sort(values[i].begin(), values[i].end());
+    for (int i = 0; i < 2; i++) {
+        cout << "Scenario " << i + 1 << ": 95% bootstrap interval [" << sorted_quantile(values[i], lo_q) * 100 << "%, "
+             << sorted_quantile(values[i], hi_q) * 100 << "%] over " << values[i].size() << " replicates." << endl;
+    }
+    double stay_wins = weights[0] * tally.stay_cnt, switch_wins = weights[1] * tally.switch_cnt;
+    cout << "Switch/stay win ratio: " << (stay_wins > 0 ? switch_wins / stay_wins : INFINITY) << ", 95% bootstrap interval ["
+         << sorted_quantile(values[2], lo_q) << ", " << sorted_quantile(values[2], hi_q) << "]." << endl;
+}
+
+/*  Function to report the running win rates at every checkpoint the run reached, with their standard errors sqrt(p(1-p)/N).
+    - The tally holds the wins between consecutive checkpoints, so the running totals are their prefix sums.
+*/
+void report_checkpoints(const SimulationConfig& cfg, const Tally& tally) {
+    double weights[2];
+    hit_weights(cfg, weights);
+    long long wins[2] = {0, 0};
+    const vector<Checkpoint>& checkpoints = tally.batches.checkpoints;
+    for (size_t c = 0; c < checkpoints.size() && checkpoints[c].games <= tally.simulations; c++) {
+        wins[0] += checkpoints[c].stay_cnt;
+        wins[1] += checkpoints[c].switch_cnt;
+        double N = checkpoints[c].games;
+        cout << "After " << checkpoints[c].games << " simulations:";
+        for (int i = 0; i < 2; i++) {
+            double h = wins[i] / N;
+            cout << (i == 0 ? " staying wins " : ", switching wins ") << weights[i] * h * 100 << "% +- " << weights[i] * sqrt(h * (1 - h) / N) * 100 << "%";
+        }
+        cout << "." << endl;
+    }
+}
+
+/*  Function to report the estimates of a run with `--variance_reduction`, with their standard errors and effective sample size gains.
+    Methodology:
+    - With antithetic pairs the units are pairs of games, otherwise single games. The estimators are means over the units,
+      and their standard errors come from the sample variances of the units.
+    - With the control variate, the switch estimate is corrected by the stay estimate, whose exact mean 1/n is known:
+      `y - beta * (x - 1/n)` with `beta = cov(x, y) / var(x)`. It keeps the switch mean but removes the part of its variance explained by x,
+      leaving `var(y) - cov(x, y)^2 / var(x)`.
+    - The gain is the ratio between the variance of a plain game and the variance per game of the unit, i.e. how many plain games one game is worth.
+*/
+void report_variance_reduction(const SimulationConfig& cfg, const UnitMoments& m) {
+    if (m.units < 2) return;
+    double U = m.units;
+    int unit_games = cfg.antithetic ? 2 : 1;
+    double mean_x = m.sum_x / U, mean_y = m.sum_y / U;
+    double var_x = (m.sum_xx - U * mean_x * mean_x) / (U - 1);
+    double var_y = (m.sum_yy - U * mean_y * mean_y) / (U - 1);
+    double cov_xy = (m.sum_xy - U * mean_x * mean_y) / (U - 1);
+
+    double estimate_y = mean_y;
+    if (cfg.control_variate && var_x > 0) {
+        double beta = cov_xy / var_x;
+        estimate_y = mean_y - beta * (mean_x - 1.0 / cfg.n);
+        // With R = 1 switching wins exactly when staying does not, and the whole variance is explained up to rounding.
+        double residual = var_y - cov_xy * cov_xy / var_x;
+        var_y = residual > 1e-9 * var_y ? residual : 0;
+    }
+    double estimates[2] = {mean_x, estimate_y};
+    double variances[2] = {var_x, var_y};
+    for (int i = 0; i < 2; i++) {
+        double plain_variance = estimates[i] * (1 - estimates[i]) / unit_games;
+        cout << "Scenario " << i + 1 << " (" << cfg.variance_reduction << "): " << estimates[i] * 100 << "% +- " << sqrt(variances[i] / U) * 100
+             << "% (standard error), effective sample size gain " << (variances[i] > 0 ? plain_variance / variances[i] : INFINITY) << "x." << endl;
+    }
+}
+
+// Outcome of the `--decide` test.
+enum Decision { UNDECIDED, SWITCH_BETTER, STAY_BETTER };
+
+/*  Function to run Wald's sequential probability ratio test (SPRT) of "does switching win more often than staying?".
+    Return Type:
+    - `SWITCH_BETTER` or `STAY_BETTER` once the answer is settled, with both error probabilities at most `error_rate`, `UNDECIDED` until then.
+
+    Methodology:
+    - A game is never won by both strategies. Given that a game is won, it is won by switching with some probability `theta`,
+      and switching is better if and only if `theta > 1/2`.
+    - The test is between `theta = 1/2 + indifference` (switching better) and `theta = 1/2 - indifference` (staying better).
+      Every switch win adds `L = log((1/2 + indifference) / (1/2 - indifference))` to the log-likelihood ratio, every stay win subtracts it, so
+      the ratio is `L * (switch_cnt - stay_cnt)`.
+    - Wald's bounds are `+-log((1 - error_rate) / error_rate)`. When both strategies are within `indifference` of each other, either answer may be given.
+*/
+Decision sprt_decision(long long stay_cnt, long long switch_cnt, double error_rate, double indifference) {
+    double step = log((0.5 + indifference) / (0.5 - indifference));
+    double bound = log((1 - error_rate) / error_rate);
+    double log_ratio = step * static_cast<double>(switch_cnt - stay_cnt);
+    if (log_ratio >= bound) return SWITCH_BETTER;
+    if (log_ratio <= -bound) return STAY_BETTER;
+    return UNDECIDED;
+}
+
+/*  Function to print exact winning probabilities, in place of a simulation. */
+void print_exact(const pair<Fraction, Fraction>& exact) {
+    cout << setprecision(12);
+    cout << "Scenario 1: " << exact.first.str() << " = " << exact.first.value() * 100 << "% wins if player sticks to the initial choice." << endl;
+    cout << "Scenario 2: " << exact.second.str() << " = " << exact.second.value() * 100 << "% wins if player switches the initial choice." << endl;
+}
+
+/*  Function to report the win rates of a run: the counts, or the weighted estimates of the importance engine. */
+void report_counts(const SimulationConfig& cfg, const Tally& tally) {
+    long long simulations = tally.simulations;
+    long long stay_cnt = tally.stay_cnt;
+    long long switch_cnt = tally.switch_cnt;
+    double res1 = static_cast<double>(stay_cnt) / static_cast<double>(simulations);
+    double res2 = static_cast<double>(switch_cnt) / static_cast<double>(simulations);
+
+    if (cfg.engine == ENGINE_IMPORTANCE) {
+        double estimates[2], std_errors[2];
+        importance_estimates(cfg.n, cfg.k, cfg.importance_bias, simulations, stay_cnt, switch_cnt, estimates, std_errors);
+        cout << "Scenario 1: " << estimates[0] * 100 << "% +- " << std_errors[0] * 100 << "% (standard error) wins if player sticks to the initial choice." << endl;
+        cout << "Scenario 2: " << estimates[1] * 100 << "% +- " << std_errors[1] * 100 << "% (standard error) wins if player switches the initial choice." << endl;
+        for (int i = 0; i < 2; i++) {
+            // Number of plain games that would give the same standard error.
+            double plain_simulations = std_errors[i] > 0 ? estimates[i] * (1 - estimates[i]) / (std_errors[i] * std_errors[i]) : INFINITY;
+            cout << "Scenario " << i + 1 << ": " << (i == 0 ? stay_cnt : switch_cnt) << "/" << simulations << " games hit, worth "
+                 << plain_simulations << " plain simulations (" << plain_simulations / simulations << "x)." << endl;
+        }
+    }
+    else {
+        cout << "Scenario 1: " << stay_cnt << "/" << simulations<< " = " <<  res1 * 100 << "% wins if player sticks to the initial choice." << endl;
+        cout << "Scenario 2: " << switch_cnt << "/" << simulations<< " = " << res2 * 100 << "% wins if player switches the initial choice." << endl;
+    }
+}
+
+/*  Function to report the standard errors, bootstrap intervals and checkpoints of an iid run, whichever were asked for. */
+void report_spread(const SimulationConfig& cfg, const Tally& tally) {
+    if (cfg.sampling == SAMPLING_IID) report_batch_means(cfg, tally);
+    if (cfg.bootstrap > 0) report_bootstrap(cfg, tally);
+    if (!cfg.checkpoints.empty()) report_checkpoints(cfg, tally);
+}
+
+// First line of a saved run state, with the version of its format.
+const string RUN_STATE_HEADER = "MontyHall run state 1";
+
+/*  Function to describe every option that changes the games of a seeded run or what is counted about them.
+    A run can only be resumed with the same description.
+*/
+string run_signature(const SimulationConfig& cfg) {
+    ostringstream out;
+    out << setprecision(17) << "n " << cfg.n << " k " << cfg.k << " engine " << cfg.engine << " batch_size " << cfg.batch_size
+        << " bootstrap " << cfg.bootstrap << " variance_reduction " << cfg.variance_reduction << " importance_bias " << cfg.importance_bias << " checkpoints";
+    for (size_t c = 0; c < cfg.checkpoints.size(); c++) out << " " << cfg.checkpoints[c];
+    if (cfg.engine == ENGINE_RANDOMISED && cfg.n >= PARALLEL_MIN_DOORS) out << " threads " << cfg.threads;
+    return out.str();
+}
+
+/*  Function to save the state of a seeded run after the games [0, tally.simulations), to `cfg.checkpoint_file`.
+    - The state is the seed, `run_signature()`, the end of the current round of games `round_end`, and every total of `tally`.
+      The generators need not be saved: every block of games seeds its own, from the seed and its first game.
+    - Doubles are written with 17 digits, so they are read back exactly.
+    - The state is written to a temporary file, which then replaces the old one, so a run killed while saving still leaves the previous state.
+*/
+void save_run_state(const SimulationConfig& cfg, const Tally& tally, long long round_end) {
+    string temporary = cfg.checkpoint_file + ".tmp";
+    {
+        ofstream out(temporary.c_str());
+        out << setprecision(17);
+        out << RUN_STATE_HEADER << "\n" << "seed " << cfg.seed << "\n" << run_signature(cfg) << "\n";
+        out << "round_end " << round_end << "\n";
+        out << "totals " << tally.simulations << " " << tally.stay_cnt << " " << tally.switch_cnt << "\n";
+        const UnitMoments& m = tally.moments;
+        out << "moments " << m.units << " " << m.sum_x << " " << m.sum_y << " " << m.sum_xx << " " << m.sum_yy << " " << m.sum_xy << "\n";
+        const BatchMoments& b = tally.batches;
+        out << "batches " << b.batches << " " << b.sum_x << " " << b.sum_y << " " << b.sum_xx << " " << b.sum_yy << "\n";
+        for (size_t r = 0; r < b.bootstrap.size(); r++) {
+            out << "bootstrap " << b.bootstrap[r].games << " " << b.bootstrap[r].stay_cnt << " " << b.bootstrap[r].switch_cnt << "\n";
+        }
+        for (size_t c = 0; c < b.checkpoints.size(); c++) {
+            out << "checkpoint " << b.checkpoints[c].games << " " << b.checkpoints[c].stay_cnt << " " << b.checkpoints[c].switch_cnt << "\n";
+        }
+        out.close();
+        if (!out) {
+            cerr << "Could not write the run state to " << temporary << "." << endl;
+            abort();
+        }
+    }
+#ifdef _WIN32
+    remove(cfg.checkpoint_file.c_str());     // Windows does not rename over an existing file.
+#endif
+    if (rename(temporary.c_str(), cfg.checkpoint_file.c_str()) != 0) {
+        cerr << "Could not replace " << cfg.checkpoint_file << " with the new run state." << endl;
+        abort();
+    }
+}
+
+/*  Function to read the seed saved in the run state `file`.
+    Return Type:
+    - It returns false if there is no such file, so that a run can be started and resumed with the same command line.
+*/
+bool saved_run_seed(const string& file, uint64_t& seed) {
+    ifstream in(file.c_str());
+    if (!in) return false;
+    string header, label;
+    getline(in, header);
+    if (header != RUN_STATE_HEADER || !(in >> label >> seed) || label != "seed") {
+        cerr << file << " is not a saved run state." << endl;
+        abort();
+    }
+    return true;
+}
+
+/*  Function to load the run state saved by `save_run_state()` into `tally` and `round_end`.
+    `tally` must be empty, and `cfg` must have the options the state was saved with.
+*/
+void load_run_state(const SimulationConfig& cfg, Tally& tally, long long& round_end) {
+    ifstream in(cfg.resume.c_str());
+    string line, signature;
+    getline(in, line);
+    getline(in, line);
+    getline(in, signature);
+    if (signature != run_signature(cfg)) {
+        cerr << "The run in " << cfg.resume << " was saved with different options:" << endl << "  " << signature << endl
+             << "The options of this run are:" << endl << "  " << run_signature(cfg) << endl;
+        abort();
+    }
+    bool ok = true;
+    // Reads the next line, which must start with `expected`.
+    auto field = [&](const char* expected) -> istream& {
+        string label;
+        if (!(in >> label) || label != expected) ok = false;
+        return in;
+    };
+    UnitMoments& m = tally.moments;
+    BatchMoments& b = tally.batches;
+    field("round_end") >> round_end;
+    field("totals") >> tally.simulations >> tally.stay_cnt >> tally.switch_cnt;
+    field("moments") >> m.units >> m.sum_x >> m.sum_y >> m.sum_xx >> m.sum_yy >> m.sum_xy;
+    field("batches") >> b.batches >> b.sum_x >> b.sum_y >> b.sum_xx >> b.sum_yy;
+    for (size_t r = 0; r < b.bootstrap.size(); r++) field("bootstrap") >> b.bootstrap[r].games >> b.bootstrap[r].stay_cnt >> b.bootstrap[r].switch_cnt;
+    for (size_t c = 0; c < b.checkpoints.size(); c++) field("checkpoint") >> b.checkpoints[c].games >> b.checkpoints[c].stay_cnt >> b.checkpoints[c].switch_cnt;
+    if (!ok || !in) {
+        cerr << "The run state in " << cfg.resume << " is damaged." << endl;
+        abort();
+    }
+}
+
+// First bytes of a shard's partial results, with the version of the format.
+const char SHARD_MAGIC[8] = {'M', 'H', 'S', 'H', 'A', 'R', 'D', 1};
+
+/*  Function to find the games [first, end) of shard `cfg.shard` out of `cfg.shards`.
+    The shards split the blocks of `seeded_block_games()`, so every game is in the same block, with the same generator, as in an unsharded run.
+*/
+void shard_range(const SimulationConfig& cfg, long long& first, long long& end) {
+    long long block = seeded_block_games(cfg);
+    long long blocks = (cfg.simulations - 1) / block + 1;
+    first = min(cfg.simulations, static_cast<long long>(static_cast<uint128>(blocks) * cfg.shard / cfg.shards) * block);
+    end = min(cfg.simulations, static_cast<long long>(static_cast<uint128>(blocks) * (cfg.shard + 1) / cfg.shards) * block);
+}
+
+/*  Functions to write and read a value in native byte order. */
+template <typename T>
+void write_binary(ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_binary(istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+/*  The partial results of a shard, as read from its file. */
+struct ShardPartial {
+    uint64_t seed;
+    string signature;
+    int shard, shards;
+    long long simulations;                   // Number of simulations of the whole sharded run.
+    long long first, end;                    // The games of this shard.
+    Tally tally;
+};
+
+/*  Function to write the partial results of the games [first, end) of a shard to `cfg.shard_file`.
+    - The file holds `SHARD_MAGIC`, the seed, `run_signature()`, the shard, the games it covers, and every total of `tally`,
+      in native byte order. Doubles are stored bit for bit.
+*/
+void write_shard(const SimulationConfig& cfg, const Tally& tally, long long first, long long end) {
+    ofstream out(cfg.shard_file.c_str(), ios::binary);
+    string signature = run_signature(cfg);
+    out.write(SHARD_MAGIC, sizeof(SHARD_MAGIC));
+    write_binary(out, cfg.seed);
+    write_binary(out, static_cast<uint32_t>(signature.size()));
+    out.write(signature.data(), signature.size());
+    write_binary(out, cfg.shard);
+    write_binary(out, cfg.shards);
+    write_binary(out, cfg.simulations);
+    write_binary(out, first);
+    write_binary(out, end);
+    write_binary(out, tally.simulations);
+    write_binary(out, tally.stay_cnt);
+    write_binary(out, tally.switch_cnt);
+    write_binary(out, tally.moments);
+    const BatchMoments& b = tally.batches;
+    write_binary(out, b.batches);
+    write_binary(out, b.sum_x);
+    write_binary(out, b.sum_y);
+    write_binary(out, b.sum_xx);
+    write_binary(out, b.sum_yy);
+    write_binary(out, static_cast<uint32_t>(b.bootstrap.size()));
+    for (size_t r = 0; r < b.bootstrap.size(); r++) write_binary(out, b.bootstrap[r]);
+    write_binary(out, static_cast<uint32_t>(b.checkpoints.size()));
+    for (size_t c = 0; c < b.checkpoints.size(); c++) write_binary(out, b.checkpoints[c]);
+    out.close();
+    if (!out) {
+        cerr << "Could not write the shard to " << cfg.shard_file << "." << endl;
+        abort();
+    }
+}
+
+/*  Function to read the partial results in `file` into `partial`.
+    Return Type:
+    - It returns false, after saying why, if the file is not a complete shard.
+*/
+bool read_shard(const string& file, ShardPartial& partial) {
+    ifstream in(file.c_str(), ios::binary);
+    char magic[sizeof(SHARD_MAGIC)];
+    uint32_t length = 0, replicates = 0, checkpoints = 0;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, SHARD_MAGIC, sizeof(SHARD_MAGIC)) != 0
+        || !read_binary(in, partial.seed) || !read_binary(in, length) || length > 1 << 16) {
+        cerr << file << " is not a shard of a run." << endl;
+        return false;
+    }
+    partial.signature.resize(length);
+    partial.tally = Tally();
+    Tally& tally = partial.tally;
+    BatchMoments& b = tally.batches;
+    bool ok = static_cast<bool>(in.read(&partial.signature[0], length))
+        && read_binary(in, partial.shard) && read_binary(in, partial.shards) && read_binary(in, partial.simulations)
+        && read_binary(in, partial.first) && read_binary(in, partial.end)
+        && partial.shard >= 0 && partial.shard < partial.shards && partial.first <= partial.end
+        && read_binary(in, tally.simulations) && read_binary(in, tally.stay_cnt) && read_binary(in, tally.switch_cnt) && read_binary(in, tally.moments)
+        && read_binary(in, b.batches) && read_binary(in, b.sum_x) && read_binary(in, b.sum_y) && read_binary(in, b.sum_xx) && read_binary(in, b.sum_yy)
+        && read_binary(in, replicates) && replicates <= 1 << 24;
+    if (ok) b.bootstrap.resize(replicates);
+    for (size_t r = 0; ok && r < b.bootstrap.size(); r++) ok = read_binary(in, b.bootstrap[r]);
+    ok = ok && read_binary(in, checkpoints) && checkpoints <= 1 << 16;
+    if (ok) b.checkpoints.resize(checkpoints);
+    for (size_t c = 0; ok && c < b.checkpoints.size(); c++) ok = read_binary(in, b.checkpoints[c]);
+    if (!ok) {
+        cerr << file << " is damaged." << endl;
+        return false;
+    }
+    return true;
+}
+
+/*  Function to merge the partial results of the shards in `files` into `tally`.
+    Return Type:
+    - It returns false, after saying why, if a file can not be read, or if the shards are not disjoint parts of one run with the options of `cfg`.
+    - Shards may be missing. The merged results are then those of the games the shards cover, which are listed.
+
+    Methodology:
+    - Every shard must have the seed of the first one, the same `run_signature()` as `cfg`, and the same number of simulations and shards.
+    - The shards are sorted by their first game, and each must start at or after the end of the one before.
+    - All counts are integers, and the sums of the batch means and variance reduction are sums of small integers or multiples of 1/4,
+      which doubles add exactly.
+      So the merge gives exactly the totals of the unsharded run with the same seed, in any order.
+*/
+bool merge_shards(SimulationConfig& cfg, const vector<string>& files, Tally& tally) {
+    vector<ShardPartial> partials(files.size());
+    for (size_t f = 0; f < files.size(); f++) {
+        if (!read_shard(files[f], partials[f])) return false;
+        const ShardPartial& p = partials[f];
+        string mismatch;
+        if (p.signature != run_signature(cfg)) mismatch = "other options (" + p.signature + ")";
+        else if (p.seed != partials[0].seed || (cfg.seeded && p.seed != cfg.seed)) mismatch = "a different seed";
+        else if (p.simulations != cfg.simulations) mismatch = "a different number of simulations";
+        else if (p.shards != partials[0].shards) mismatch = "a different number of shards";
+        if (!mismatch.empty()) {
+            cerr << files[f] << " does not fit this merge: it is a shard of a run with " << mismatch << "." << endl;
+            return false;
+        }
+    }
+    vector<size_t> order(files.size());
+    for (size_t f = 0; f < order.size(); f++) order[f] = f;
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return partials[a].first < partials[b].first; });
+    for (size_t i = 1; i < order.size(); i++) {
+        const ShardPartial& before = partials[order[i - 1]];
+        if (partials[order[i]].first < before.end || partials[order[i]].shard == before.shard) {
+            cerr << files[order[i]] << " overlaps " << files[order[i - 1]] << "." << endl;
+            return false;
+        }
+    }
+    cfg.seed = partials[0].seed;
+    tally = empty_tally(cfg);
+    long long covered = 0;
+    for (size_t f = 0; f < partials.size(); f++) {
+        merge_tally(tally, partials[f].tally);
+        covered += partials[f].end - partials[f].first;
+    }
+    // The running win rates of `--checkpoints` are only known while the games are covered without a gap from game 0.
+    long long prefix = 0;
+    for (size_t i = 0; i < order.size() && partials[order[i]].first == prefix; i++) prefix = partials[order[i]].end;
+    vector<Checkpoint>& checkpoints = tally.batches.checkpoints;
+    while (!checkpoints.empty() && checkpoints.back().games > prefix) checkpoints.pop_back();
+    cout << "Merged " << files.size() << " of " << partials[0].shards << " shards with seed " << cfg.seed << "." << endl;
+    if (covered < cfg.simulations) {
+        cout << "The shards cover " << covered << " of " << cfg.simulations << " simulations. Missing shards:";
+        vector<bool> present(partials[0].shards, false);
+        for (size_t f = 0; f < partials.size(); f++) present[partials[f].shard] = true;
+        for (int i = 0; i < partials[0].shards; i++) {
+            if (!present[i]) cout << " " << i;
+        }
+        cout << "." << endl;
+        if (!cfg.checkpoints.empty()) cout << "The convergence curve stops after " << prefix << " simulations, the games covered from the first one." << endl;
+    }
+    return true;
+}
+
+/*  Function to report merged results, and check them with `--verify`. It returns false if the check fails. */
+bool report_merged(const SimulationConfig& cfg, const Tally& tally) {
+    if (tally.simulations == 0) return true;
+    report_counts(cfg, tally);
+    report_spread(cfg, tally);
+    if (cfg.antithetic || cfg.control_variate) report_variance_reduction(cfg, tally.moments);
+    if (cfg.verify && cfg.engine == ENGINE_IMPORTANCE) {
+        double estimates[2], std_errors[2];
+        importance_estimates(cfg.n, cfg.k, cfg.importance_bias, tally.simulations, tally.stay_cnt, tally.switch_cnt, estimates, std_errors);
+        return verify_estimates(cfg.n, cfg.k, estimates, std_errors);
+    }
+    return !cfg.verify || verify_against_exact(cfg.n, cfg.k, tally.simulations, tally.stay_cnt, tally.switch_cnt);
+}
+
+// How long a process of a work queue waits before looking for work again, when all the chunks left are leased by others.
+const double QUEUE_POLL_SECONDS = 0.5;
+
+#ifndef _WIN32
+/*  Function to name the private files of this process in a work queue. The directory may be shared between machines, so the name has the host as well as the process id. */
+string private_suffix() {
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    return string(host) + "." + to_string(getpid());
+}
+
+/*  Function to join the work queue in `cfg.work_dir`, or to set it up if this process is the first.
+    - The first process writes the seed, the number of simulations and chunks, and `run_signature()` to `run` in the directory.
+      It is written to a private file first and then linked into place, which fails if another process got there first,
+      so every process reads a complete description.
+    - A process with other options, or another `--seed`, is turned away. Without `--seed`, it takes the seed of the queue.
+*/
+void join_work_queue(SimulationConfig& cfg) {
+    if (!cfg.seeded) cfg.seed = static_cast<uint64_t>(rng()) << 32 | rng();
+    mkdir(cfg.work_dir.c_str(), 0755);
+    string run_file = cfg.work_dir + "/run";
+    ostringstream description;
+    description << "MontyHall work queue 1\n" << "simulations " << cfg.simulations << "\n" << "chunks " << cfg.chunks << "\n" << run_signature(cfg) << "\n";
+    string temporary = run_file + ".tmp." + private_suffix();
+    {
+        ofstream out(temporary.c_str());
+        out << "seed " << cfg.seed << "\n" << description.str();
+    }
+    bool created = link(temporary.c_str(), run_file.c_str()) == 0;
+    unlink(temporary.c_str());
+    ifstream in(run_file.c_str());
+    string label, rest;
+    uint64_t seed = 0;
+    if (!(in >> label >> seed) || label != "seed") {
+        cerr << "Could not set up or read the work queue in " << cfg.work_dir << "." << endl;
+        abort();
+    }
+    getline(in, rest);
+    rest.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    if (rest != description.str() || (cfg.seeded && seed != cfg.seed)) {
+        cerr << "The work queue in " << cfg.work_dir << " is for another run:" << endl << rest << "seed " << seed << endl;
+        abort();
+    }
+    cfg.seed = seed;
+    cfg.seeded = true;
+    if (created) cout << "Set up the work queue in " << cfg.work_dir << "." << endl;
+}
+
+/*  Function to lease chunk `chunk` of the work queue. It returns false if another process holds a live lease on it.
+    - A lease is a file created with O_EXCL, so only one process can create it.
+    - A lease that has not been renewed for `cfg.lease_timeout` seconds belongs to a process that died or lost the directory.
+      It is renamed to a name of this process's own before a new lease is created. If the renamed file turns out to be fresh,
+      another process took the stale lease over first and this one moved its new lease away, so it is linked back and the chunk left alone.
+    - This does not rule out every race: a process can still lose its lease to a takeover, or remove a lease that is no longer its own,
+      and then two processes simulate the same chunk. That only costs time, since the results of a chunk only depend on the seed and the chunk,
+      and each process publishes them with a rename of a complete file.
+*/
+bool lease_chunk(const SimulationConfig& cfg, const string& lease) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int file = open(lease.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (file >= 0) {
+            char host[256] = "";
+            gethostname(host, sizeof(host) - 1);
+            string owner = to_string(getpid()) + "@" + host + "\n";
+            if (write(file, owner.data(), owner.size()) < 0) {}   // The owner is only there for people looking at the directory.
+            close(file);
+            return true;
+        }
+        struct stat info;
+        if (attempt > 0 || stat(lease.c_str(), &info) != 0 || difftime(time(NULL), info.st_mtime) < cfg.lease_timeout) return false;
+        string stale = lease + ".stale." + private_suffix();
+        if (rename(lease.c_str(), stale.c_str()) != 0) return false;
+        bool fresh = stat(stale.c_str(), &info) == 0 && difftime(time(NULL), info.st_mtime) < cfg.lease_timeout;
+        if (fresh && link(stale.c_str(), lease.c_str()) != 0) {}   // Someone may have leased the chunk again meanwhile. Either way it is leased.
+        unlink(stale.c_str());
+        if (fresh) return false;
+    }
+    return false;
+}
+
+/*  Function to be one of the processes of the work queue in `cfg.work_dir`, and report the whole run once all its chunks are done.
+    Return Type:
+    - It returns false if `--verify` fails.
+
+    Methodology:
+    - The games of the seeded run are split into `cfg.chunks` chunks, the shards of `shard_range()`.
+    - The process repeatedly looks for a chunk without results, leases it with `lease_chunk()`, simulates it with all its threads,
+      and writes its partial results to the directory, as `write_shard()` would for that shard: to a private file, renamed into place.
+    - While it works on a chunk, a second thread renews the lease every quarter of `cfg.lease_timeout` by touching the file.
+    - So fast hosts simply take more chunks, and the chunks of processes that die are taken over once their leases expire.
+    - The results of a chunk only depend on the seed and the chunk, so a chunk done twice, after a lease was wrongly taken over,
+      gives the same file twice, and no result is ever counted twice.
+    - When every chunk has its results, the process merges them with `merge_shards()` and reports the whole run.
+      The same files can also be combined with `MontyHall merge`.
+*/
+bool run_work_queue(SimulationConfig cfg) {
+    join_work_queue(cfg);
+    cfg.shards = cfg.chunks;
+    vector<string> parts(cfg.chunks);
+    for (int c = 0; c < cfg.chunks; c++) parts[c] = cfg.work_dir + "/shard_" + to_string(c) + "_of_" + to_string(cfg.chunks) + ".part";
+    auto finished = [&](int c) { return access(parts[c].c_str(), F_OK) == 0; };
+
+    int done_here = 0;
+    long long simulated_here = 0;
+    while (true) {
+        bool all_done = true, worked = false;
+        for (int c = 0; c < cfg.chunks; c++) {
+            if (finished(c)) continue;
+            all_done = false;
+            string lease = cfg.work_dir + "/shard_" + to_string(c) + "_of_" + to_string(cfg.chunks) + ".lease";
+            if (!lease_chunk(cfg, lease)) continue;
+            if (finished(c)) {
+                unlink(lease.c_str());
+                continue;
+            }
+            mutex lock;
+            condition_variable wake;
+            bool chunk_done = false;
+            thread renew([&] {
+                unique_lock<mutex> guard(lock);
+                while (!wake.wait_for(guard, chrono::duration<double>(cfg.lease_timeout / 4), [&] { return chunk_done; })) utime(lease.c_str(), NULL);
+            });
+            long long first, end;
+            cfg.shard = c;
+            shard_range(cfg, first, end);
+            Tally tally = empty_tally(cfg);
+            run_games(cfg, first, end - first, tally, NULL, NULL);
+            cfg.shard_file = parts[c] + ".tmp." + private_suffix();
+            write_shard(cfg, tally, first, end);
+            if (rename(cfg.shard_file.c_str(), parts[c].c_str()) != 0) {
+                cerr << "Could not move the results of chunk " << c << " to " << parts[c] << "." << endl;
+                abort();
+            }
+            {
+                lock_guard<mutex> guard(lock);
+                chunk_done = true;
+            }
+            wake.notify_one();
+            renew.join();
+            unlink(lease.c_str());
+            done_here++;
+            simulated_here += end - first;
+            worked = true;
+        }
+        if (all_done) break;
+        if (!worked) this_thread::sleep_for(chrono::duration<double>(QUEUE_POLL_SECONDS));
+    }
+
+    cout << "Queue Results" << endl;
+    cout << "This process simulated " << done_here << " of " << cfg.chunks << " chunks, " << simulated_here << " of " << cfg.simulations << " simulations." << endl;
+    Tally tally;
+    if (!merge_shards(cfg, parts, tally)) abort();
+    return report_merged(cfg, tally);
+}
+
+/*  The fixed part of a worker's slot in the shared mapping of `simulate_processes()`.
+    The worker's bootstrap replicates and checkpoints follow it.
+*/
+struct WorkerSlot {
+    long long finished;                      // 1 once the worker has written its totals.
+    long long simulations, stay_cnt, switch_cnt;
+    UnitMoments moments;
+    long long batches;
+    double sum_x, sum_y, sum_xx, sum_yy;
+};
+
+/*  Function to simulate the games of `cfg` in `cfg.processes` forked worker processes, and return their merged totals.
+    Methodology:
+    - The run is seeded, so the games are the blocks of `seeded_block_games()`, each with its own generator, and the totals
+      are exactly those of the same run in one process, however the blocks are shared out.
+    - Before forking, the parent maps one shared anonymous region: a page with the counter of the next game, and one slot per worker,
+      each a whole number of pages (so also of cache lines) holding a `WorkerSlot`, and the bootstrap replicates and checkpoints of a `Tally`.
+    - Every worker makes the slots of the other workers read-only with `mprotect()`, so it can only write its own.
+      Its `cfg.threads` threads claim the blocks straight from the counter in `run_games()`, as the threads of one process would.
+      It then copies its tally into its slot and leaves with `_exit()`, so it never flushes the parent's buffered output.
+    - The parent waits for all the workers and adds up their slots. A worker that failed leaves games nobody simulated,
+      so the other workers are killed and the run is stopped.
+*/
+Tally simulate_processes(SimulationConfig cfg, vector<long long>& per_worker) {
+    if (!cfg.seeded) cfg.seed = static_cast<uint64_t>(rng()) << 32 | rng();
+    cfg.seeded = true;
+    Tally empty = empty_tally(cfg);
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t slot_bytes = sizeof(WorkerSlot) + empty.batches.bootstrap.size() * sizeof(BootstrapReplicate) + empty.batches.checkpoints.size() * sizeof(Checkpoint);
+    size_t stride = (slot_bytes + page - 1) / page * page;
+    size_t bytes = page + cfg.processes * stride;
+    char* shared = static_cast<char*>(mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    if (shared == MAP_FAILED) {
+        cerr << "Could not map memory shared with the worker processes." << endl;
+        abort();
+    }
+    atomic<long long>* next_game = new (shared) atomic<long long>(0);
+
+    cout.flush();
+    vector<pid_t> workers;
+    for (int w = 0; w < cfg.processes; w++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "Could not fork worker process " << w << "." << endl;
+            abort();
+        }
+        if (pid > 0) {
+            workers.push_back(pid);
+            continue;
+        }
+        for (int other = 0; other < cfg.processes; other++) {
+            if (other != w && mprotect(shared + page + other * stride, stride, PROT_READ) != 0) _exit(1);
+        }
+        Tally tally = empty_tally(cfg);
+        run_games(cfg, 0, cfg.simulations, tally, NULL, NULL, next_game);
+        char* slot = shared + page + w * stride;
+        const BatchMoments& b = tally.batches;
+        WorkerSlot totals = {1, tally.simulations, tally.stay_cnt, tally.switch_cnt, tally.moments, b.batches, b.sum_x, b.sum_y, b.sum_xx, b.sum_yy};
+        if (!b.bootstrap.empty()) memcpy(slot + sizeof(WorkerSlot), b.bootstrap.data(), b.bootstrap.size() * sizeof(BootstrapReplicate));
+        if (!b.checkpoints.empty()) {
+            memcpy(slot + sizeof(WorkerSlot) + b.bootstrap.size() * sizeof(BootstrapReplicate), b.checkpoints.data(), b.checkpoints.size() * sizeof(Checkpoint));
+        }
+        memcpy(slot, &totals, sizeof(WorkerSlot));
+        _exit(0);
+    }
+
+    bool failed = false;
+    vector<pid_t> running = workers;
+    while (!running.empty() && !failed) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        failed = pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        if (pid > 0) running.erase(remove(running.begin(), running.end(), pid), running.end());
+    }
+    if (failed) {
+        // The others would only simulate games that can not be reported. The pids of workers already waited for may belong to other processes by now.
+        for (size_t w = 0; w < running.size(); w++) kill(running[w], SIGKILL);
+        for (size_t w = 0; w < running.size(); w++) waitpid(running[w], NULL, 0);
+    }
+    Tally tally = empty;
+    per_worker.clear();
+    for (int w = 0; w < cfg.processes && !failed; w++) {
+        const char* slot = shared + page + w * stride;
+        WorkerSlot totals;
+        memcpy(&totals, slot, sizeof(WorkerSlot));
+        failed = totals.finished != 1;
+        Tally part = empty;
+        part.simulations = totals.simulations;
+        part.stay_cnt = totals.stay_cnt;
+        part.switch_cnt = totals.switch_cnt;
+        part.moments = totals.moments;
+        part.batches.batches = totals.batches;
+        part.batches.sum_x = totals.sum_x;
+        part.batches.sum_y = totals.sum_y;
+        part.batches.sum_xx = totals.sum_xx;
+        part.batches.sum_yy = totals.sum_yy;
+        if (!part.batches.bootstrap.empty()) {
+            memcpy(part.batches.bootstrap.data(), slot + sizeof(WorkerSlot), part.batches.bootstrap.size() * sizeof(BootstrapReplicate));
+        }
+        if (!part.batches.checkpoints.empty()) {
+            memcpy(part.batches.checkpoints.data(), slot + sizeof(WorkerSlot) + part.batches.bootstrap.size() * sizeof(BootstrapReplicate),
+                   part.batches.checkpoints.size() * sizeof(Checkpoint));
+        }
+        merge_tally(tally, part);
+        per_worker.push_back(part.simulations);
+    }
+    munmap(shared, bytes);
+    if (failed) {
+        cerr << "A worker process failed, so not all the games were simulated." << endl;
+        abort();
+    }
+    return tally;
+}
+#endif
+
+/*  The totals of one configuration in the result cache: everything in a `Tally` apart from bootstrap replicates and checkpoints. */
+struct CachedResult {
+    uint64_t seed;
+    long long simulations, stay_cnt, switch_cnt;
+    UnitMoments moments;
+    long long batches;
+    double sum_x, sum_y, sum_xx, sum_yy;
+};
+
+// Longest key of the result cache, including its terminating zero.
+const size_t CACHE_KEY_SIZE = 256;
+
+/*  A slot of the result cache file. `sequence` is odd while the slot is being written, and goes up by 2 with every write.
+    A slot with an empty key has never been used.
+*/
+struct CacheSlot {
+    atomic<uint64_t> sequence;
+    char key[CACHE_KEY_SIZE];
+    CachedResult result;
+    char padding[64 - (sizeof(atomic<uint64_t>) + CACHE_KEY_SIZE + sizeof(CachedResult)) % 64];   // Slots start on cache lines.
+};
+
+struct CacheHeader {
+    char magic[16];
+    uint64_t slots;
+    char padding[64 - 16 - sizeof(uint64_t)];
+};
+
+const char CACHE_MAGIC[16] = "MontyHall cache";
+// Number of configurations a new cache file has room for.
+const uint64_t CACHE_SLOTS = 4096;
+// How often a reader retries a slot that keeps changing under it, before treating it as missing.
+const int CACHE_READ_ATTEMPTS = 1000;
+
+/*  Function to find the key of `cfg` in the result cache: the generator, the options of `run_signature()`, and the seed if one was given.
+    Runs without `--seed` share one entry, which remembers the seed it was simulated with.
+*/
+string cache_key(const SimulationConfig& cfg, bool seed_given) {
+    ostringstream out;
+    out << "rng mt19937 " << run_signature(cfg) << " seed ";
+    if (seed_given) out << cfg.seed;
+    else out << "any";
+    return out.str();
+}
+
+/*  A result cache file, shared by all the processes that use it.
+    - The file is a hash table of `CacheSlot`s, with open addressing by the FNV-1a hash of the key, and is memory-mapped by every process.
+    - Readers take no locks. A slot is copied, and the copy is only used if `sequence` was even and unchanged around it (a seqlock),
+      so a reader never sees a half-written result, and a writer is never held up by readers.
+    - Writers take an exclusive `flock()` on the file, so they change slots one at a time. A slot left odd by a writer that was killed
+      is simply written again by the next one.
+    - Entries are never removed, so a probe can stop at the first empty slot.
+*/
+class ResultCache {
+public:
+    ResultCache() : header(NULL), slots(NULL), file(-1), bytes(0) {}
+    ~ResultCache() {
+#ifndef _WIN32
+        if (header) munmap(header, bytes);
+        if (file >= 0) close(file);
+#endif
+    }
+
+    /*  Function to open the cache `path`, creating it if needed. It returns false, after saying why, if that fails. */
+    bool open_file(const string& path) {
+#ifdef _WIN32
+        cerr << "The result cache needs memory-mapped files, which are not supported on Windows." << endl;
+        return false;
+#else
+        file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (file < 0) {
+            cerr << "Could not open the cache file " << path << "." << endl;
+            return false;
+        }
+        flock(file, LOCK_EX);
+        off_t size = lseek(file, 0, SEEK_END);
+        bytes = sizeof(CacheHeader) + CACHE_SLOTS * sizeof(CacheSlot);
+        bool created = size == 0;
+        if (created && ftruncate(file, bytes) != 0) {
+            flock(file, LOCK_UN);
+            cerr << "Could not create the cache file " << path << "." << endl;
+            return false;
+        }
+        CacheHeader existing = CacheHeader();
+        // The slots of an existing cache must fill the rest of the file exactly, or the mapping would reach past its end.
+        if (!created && (pread(file, &existing, sizeof(existing), 0) != static_cast<ssize_t>(sizeof(existing)) || memcmp(existing.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+                         || existing.slots == 0 || (size - sizeof(CacheHeader)) / sizeof(CacheSlot) != existing.slots || (size - sizeof(CacheHeader)) % sizeof(CacheSlot) != 0)) {
+            flock(file, LOCK_UN);
+            cerr << path << " is not a result cache." << endl;
+            return false;
+        }
+        if (!created) bytes = sizeof(CacheHeader) + existing.slots * sizeof(CacheSlot);
+        void* memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (memory == MAP_FAILED) {
+            flock(file, LOCK_UN);
+            cerr << "Could not map the cache file " << path << "." << endl;
+            return false;
+        }
+        header = static_cast<CacheHeader*>(memory);
+        slots = reinterpret_cast<CacheSlot*>(header + 1);
+        if (created) {
+            header->slots = CACHE_SLOTS;
+            memcpy(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));   // Last, so a file is only a cache once it is complete.
+        }
+        flock(file, LOCK_UN);
+        return true;
+#endif
+    }
+
+    /*  Function to look up `key`. It returns false if the cache has no result for it. Lock-free. */
+    bool find(const string& key, CachedResult& result) const {
+        for (uint64_t probe = 0, i = hash(key) % header->slots; probe < header->slots; probe++, i = (i + 1) % header->slots) {
+            char slot_key[CACHE_KEY_SIZE];
+            if (!read_slot(slots[i], slot_key, result)) return false;
+            if (slot_key[0] == 0) return false;
+            if (key == slot_key) return true;
+        }
+        return false;
+    }
+
+    /*  Function to store `result` for `key`, unless another process has stored more simulations for it in the meantime.
+        It returns false if the cache is full.
+    */
+    bool store(const string& key, const CachedResult& result) {
+#ifdef _WIN32
+        return false;
+#else
+        flock(file, LOCK_EX);
+        bool stored = false;
+        for (uint64_t probe = 0, i = hash(key) % header->slots; probe < header->slots && !stored; probe++, i = (i + 1) % header->slots) {
+            CacheSlot& slot = slots[i];
+            if (slot.key[0] != 0 && key != slot.key) continue;
+            stored = true;
+            if (slot.key[0] != 0 && slot.result.simulations >= result.simulations) break;
+            uint64_t sequence = slot.sequence.load(memory_order_relaxed) | 1;
+            slot.sequence.store(sequence, memory_order_relaxed);
+            atomic_thread_fence(memory_order_release);
+            memset(slot.key, 0, CACHE_KEY_SIZE);
+            memcpy(slot.key, key.c_str(), key.size());
+            slot.result = result;
+            slot.sequence.store(sequence + 1, memory_order_release);
+        }
+        msync(header, bytes, MS_ASYNC);
+        flock(file, LOCK_UN);
+        return stored;
+#endif
+    }
+
+private:
+    CacheHeader* header;
+    CacheSlot* slots;
+    int file;
+    size_t bytes;
+
+    static uint64_t hash(const string& key) {
+        uint64_t h = 14695981039346656037ULL;
+        for (size_t i = 0; i < key.size(); i++) h = (h ^ static_cast<unsigned char>(key[i])) * 1099511628211ULL;
+        return h;
+    }
+
+    // Copies a slot that is not being written. Returns false if it never stops changing.
+    static bool read_slot(const CacheSlot& slot, char key[CACHE_KEY_SIZE], CachedResult& result) {
+        for (int attempt = 0; attempt < CACHE_READ_ATTEMPTS; attempt++) {
+            uint64_t before = slot.sequence.load(memory_order_acquire);
+            if (before & 1) {
+                this_thread::yield();
+                continue;
+            }
+            memcpy(key, slot.key, CACHE_KEY_SIZE);
+            result = slot.result;
+            atomic_thread_fence(memory_order_acquire);
+            if (slot.sequence.load(memory_order_relaxed) == before) {
+                key[CACHE_KEY_SIZE - 1] = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/*  Functions to convert between a tally and its entry in the result cache. */
+CachedResult cached_result(const SimulationConfig& cfg, const Tally& tally) {
+    CachedResult result = {cfg.seed, tally.simulations, tally.stay_cnt, tally.switch_cnt, tally.moments,
+                           tally.batches.batches, tally.batches.sum_x, tally.batches.sum_y, tally.batches.sum_xx, tally.batches.sum_yy};
+    return result;
+}
+
+Tally cached_tally(const SimulationConfig& cfg, const CachedResult& result) {
+    Tally tally = empty_tally(cfg);
+    tally.simulations = result.simulations;
+    tally.stay_cnt = result.stay_cnt;
+    tally.switch_cnt = result.switch_cnt;
+    tally.moments = result.moments;
+    tally.batches.batches = result.batches;
+    tally.batches.sum_x = result.sum_x;
+    tally.batches.sum_y = result.sum_y;
+    tally.batches.sum_xx = result.sum_xx;
+    tally.batches.sum_yy = result.sum_yy;
+    return tally;
+}
+
+/*  Function to repeatedly simulate the Monty Hall Problem.
+    - Without `--target_ci`, exactly `cfg.simulations` games are simulated.
+    - With `--target_ci`, games are simulated in batches until both 95% Wilson intervals are no wider than `+-cfg.target_ci`,
+      or until `cfg.simulations` games have been run. Only the batch boundaries are checked, so the loop over the games is unchanged.
+    - With `--decide`, games are simulated in the same batches until `sprt_decision()` settles whether switching is better.
+      If both are given, the run goes on until both are satisfied.
+    - With `--resume`, or a `cached` tally from the result cache, the run continues after the games already counted.
+*/
+Tally simulate(const SimulationConfig& cfg, const Tally* cached = NULL) {
+    ofstream trace_file;
+    ostream* trace = NULL;
+    if (!cfg.trace.empty()) {
+        trace_file.open(cfg.trace.c_str());
+        if (!trace_file) {
+            cerr << "Could not open the trace file " << cfg.trace << "." << endl;
+            abort();
+        }
+        trace = &trace_file;
+    }
+    ofstream outcomes_file;
+    ostream* outcomes = NULL;
+    if (!cfg.outcomes.empty()) {
+        outcomes_file.open(cfg.outcomes.c_str(), ios::binary);
+        if (!outcomes_file) {
+            cerr << "Could not open the outcomes file " << cfg.outcomes << "." << endl;
+            abort();
+        }
+        outcomes = &outcomes_file;
+    }
+
+    Tally tally = empty_tally(cfg);
+    bool adaptive = cfg.target_ci > 0 || cfg.decide;
+    bool target_reached = false;
+    Decision decision = UNDECIDED;
+    vector<Tally> replicates;
+    if (cfg.sampling != SAMPLING_IID) replicates = simulate_replicates(cfg, tally);
+    // Plain runs can be watched with `--progress` and SIGUSR1, and stopped early with Ctrl-C.
+    mutex monitor_lock;
+    condition_variable monitor_wake;
+    bool monitor_done = false;
+    thread monitor;
+    if (cfg.sampling == SAMPLING_IID) {
+        progress_memory.assign((cfg.threads + 1) * sizeof(ProgressSlot), 0);
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(progress_memory.data()) + alignof(ProgressSlot) - 1) / alignof(ProgressSlot) * alignof(ProgressSlot);
+        progress_slots = reinterpret_cast<ProgressSlot*>(aligned);
+        for (int t = 0; t < cfg.threads; t++) new (&progress_slots[t]) ProgressSlot{{0}, {0}, {0}};
+        signal(SIGINT, handle_interrupt);
+        signal(SIGTERM, handle_interrupt);
+#ifdef SIGUSR1
+        signal(SIGUSR1, handle_snapshot);
+#endif
+        monitor = thread(monitor_progress, cref(cfg), cfg.threads, ref(monitor_lock), ref(monitor_wake), cref(monitor_done));
+    }
+    // The games are run in rounds, and the stopping rules are only checked at the end of a round.
+    // Saving the state of the run may split a round, so the end of the current round is saved with it.
+    long long round_end = 0;
+    auto check_targets = [&]() {
+        if (cfg.target_ci > 0) {
+            pair<double, double> stay_ci = wilson_interval(tally.stay_cnt, tally.simulations, CONFIDENCE_Z);
+            pair<double, double> switch_ci = wilson_interval(tally.switch_cnt, tally.simulations, CONFIDENCE_Z);
+            target_reached = stay_ci.second - stay_ci.first <= 2 * cfg.target_ci && switch_ci.second - switch_ci.first <= 2 * cfg.target_ci;
+        }
+        if (cfg.decide) decision = sprt_decision(tally.stay_cnt, tally.switch_cnt, cfg.error_rate, cfg.indifference);
+    };
+    bool resumed = !cfg.resume.empty() && ifstream(cfg.resume.c_str());
+    if (resumed) {
+        load_run_state(cfg, tally, round_end);
+        cout << "Resumed after " << tally.simulations << " simulations from " << cfg.resume << "." << endl;
+    }
+    else if (cached) {
+        tally = *cached;
+        round_end = tally.simulations;
+    }
+    long long resumed_simulations = tally.simulations;
+    if (tally.simulations > 0 && tally.simulations == round_end) check_targets();
+    SimulationConfig segment = cfg;
+    chrono::steady_clock::duration save_interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(cfg.checkpoint_every));
+    chrono::steady_clock::time_point next_save = chrono::steady_clock::now() + save_interval;
+    bool out_of_time = false;
+    while (tally.simulations < cfg.simulations && !out_of_time && !stop_requested && !(adaptive && (cfg.target_ci == 0 || target_reached) && (!cfg.decide || decision != UNDECIDED))) {
+        if (tally.simulations >= round_end) {
+            long long count = cfg.simulations - tally.simulations;
+            if (adaptive) count = min(count, max(ADAPTIVE_MIN_BATCH, tally.simulations / 16));
+            if (cfg.antithetic) count -= count % 2;
+            round_end = tally.simulations + count;
+            // A batch split between two rounds would be left out of the batch means, so rounds end on batch boundaries.
+            // Runs without a limit have `cfg.simulations` = LLONG_MAX, so the rounding must not go past it.
+            if (cfg.sampling == SAMPLING_IID) {
+                if (round_end <= cfg.simulations - cfg.batch_size) round_end = (round_end + cfg.batch_size - 1) / cfg.batch_size * cfg.batch_size;
+                else round_end = cfg.simulations;
+            }
+        }
+        if (!cfg.checkpoint_file.empty()) segment.deadline = min(cfg.deadline, next_save);
+        run_games(segment, tally.simulations, round_end - tally.simulations, tally, trace, outcomes);
+        if (!cfg.checkpoint_file.empty() && chrono::steady_clock::now() >= next_save) {
+            save_run_state(cfg, tally, round_end);
+            next_save = chrono::steady_clock::now() + save_interval;
+        }
+        out_of_time = cfg.time_limit > 0 && chrono::steady_clock::now() >= cfg.deadline;
+        if (tally.simulations == round_end) check_targets();
+    }
+    if (monitor.joinable()) {
+        {
+            lock_guard<mutex> guard(monitor_lock);
+            monitor_done = true;
+        }
+        monitor_wake.notify_one();
+        monitor.join();
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        progress_slots = NULL;
+        progress_memory.clear();
+    }
+    if (!cfg.checkpoint_file.empty()) save_run_state(cfg, tally, round_end);
+    bool interrupted = stop_requested;
+    if (interrupted) {
+        cout << "Interrupted: the results are for the " << tally.simulations << " simulations finished before the run was stopped." << endl;
+        if (!cfg.checkpoint_file.empty()) cout << "The run can be continued with --resume " << cfg.checkpoint_file << "." << endl;
+    }
+    if (tally.simulations == 0) return tally;
+    long long simulations = tally.simulations;
+    long long stay_cnt = tally.stay_cnt;
+    long long switch_cnt = tally.switch_cnt;
+    report_counts(cfg, tally);
+    if (cfg.time_limit > 0) {
+        double seconds = cfg.time_limit + chrono::duration<double>(chrono::steady_clock::now() - cfg.deadline).count();
+        long long ran = simulations - resumed_simulations;
+        cout << (out_of_time ? "The time limit was reached after " : "All ") << ran << " simulations ran in " << seconds << " seconds, "
+             << ran / seconds << " simulations per second." << endl;
+    }
+    report_spread(cfg, tally);
+
+    if (cfg.target_ci > 0) {
+        pair<double, double> stay_ci = wilson_interval(stay_cnt, simulations, CONFIDENCE_Z);
+        pair<double, double> switch_ci = wilson_interval(switch_cnt, simulations, CONFIDENCE_Z);
+        cout << "Scenario 1: 95% confidence interval [" << stay_ci.first * 100 << "%, " << stay_ci.second * 100 << "%]." << endl;
+        cout << "Scenario 2: 95% confidence interval [" << switch_ci.first * 100 << "%, " << switch_ci.second * 100 << "%]." << endl;
+        if (target_reached) cout << "Both intervals reached +-" << cfg.target_ci * 100 << "% after " << simulations << " simulations." << endl;
+        else if (interrupted) cout << "The run was interrupted after " << simulations << " simulations, before both intervals were within +-" << cfg.target_ci * 100 << "%." << endl;
+        else if (out_of_time) cout << "The time limit was reached after " << simulations << " simulations, before both intervals were within +-" << cfg.target_ci * 100 << "%." << endl;
+        else cout << "The limit of " << simulations << " simulations was reached before both intervals were within +-" << cfg.target_ci * 100 << "%." << endl;
+    }
+    if (cfg.antithetic || cfg.control_variate) report_variance_reduction(cfg, tally.moments);
+    if (cfg.sampling != SAMPLING_IID) report_replicates(cfg, tally, replicates);
+    if (cfg.decide) {
+        if (decision == SWITCH_BETTER) cout << "Decision: switching is better";
+        else if (decision == STAY_BETTER) cout << "Decision: staying is better";
+        else cout << "Decision: undecided";
+        cout << " after " << simulations << " simulations (error rate " << cfg.error_rate * 100 << "%, indifference +-" << cfg.indifference * 100 << "%)." << endl;
+    }
+    return tally;
+}
+
+// Number of simulations every number of opened doors gets in the first round of a race. It doubles every round.
+const long long RACE_FIRST_ROUND = 256;
+
+/*  A number of opened doors taking part in a race, with the games simulated for it so far. */
+struct RaceEntrant {
+    int k;
+    Tally tally;
+};
+
+/*  Function to find the number of doors the host should open, if the player switches and every opened door costs `cfg.door_cost` of the prize.
+    Return Type:
+    - It returns the best `k`, and prints how the race went.
+    - If `cfg.simulations` games run out before a single `k` is left, the leader is returned, and the ones it could not be told apart from are listed.
+
+    Methodology:
+    - The expected value of `k` is its switching win rate minus `k * door_cost`. Every `k` from 0 to n-2 starts the race.
+    - In round r, every `k` still in the race is simulated until it has `RACE_FIRST_ROUND * 2^(r-1)` games. Then every `k` whose upper confidence bound
+      is below the best lower bound is dropped, so clearly worse values only get the games of the first rounds.
+    - The bounds are Wilson intervals with `z = sqrt(2 ln(2 / delta_r))`, which bounds each normal tail by `delta_r / 2`.
+      Round r uses `delta_r = error_rate / (entrants * r * (r+1))`, which sums to `error_rate` over all values and rounds,
+      so the returned `k` is the best one with probability at least `1 - error_rate`, no matter when the race stops.
+
+    Time Complexity:
+    - A `k` whose value is `gap` below the best one is dropped after about `ln(entrants / error_rate) / gap^2` games.
+*/
+int race_doors(const SimulationConfig& cfg, vector<int>& contenders) {
+    vector<RaceEntrant> entrants;
+    for (int k = 0; k <= cfg.n - 2; k++) {
+        RaceEntrant e;
+        e.k = k;
+        e.tally = empty_tally(cfg);
+        entrants.push_back(e);
+    }
+    double n_entrants = entrants.size();
+    long long used = 0;
+    long long per_entrant = 0;
+    vector<pair<double, double> > bounds;
+    for (int round = 1; entrants.size() > 1; round++) {
+        long long target = RACE_FIRST_ROUND << min(round - 1, 40);
+        if (used + static_cast<double>(target - per_entrant) * entrants.size() > cfg.simulations) break;
+        for (size_t i = 0; i < entrants.size(); i++) {
+            SimulationConfig entrant_cfg = cfg;
+            entrant_cfg.k = entrants[i].k;
+            run_games(entrant_cfg, per_entrant, target - per_entrant, entrants[i].tally, NULL, NULL);
+        }
+        used += (target - per_entrant) * entrants.size();
+        per_entrant = target;
+
+        double delta = cfg.error_rate / (n_entrants * round * (round + 1));
+        double z = sqrt(2 * log(2 / delta));
+        bounds.clear();
+        double best_lower = -INFINITY;
+        for (size_t i = 0; i < entrants.size(); i++) {
+            pair<double, double> ci = wilson_interval(entrants[i].tally.switch_cnt, per_entrant, z);
+            double cost = entrants[i].k * cfg.door_cost;
+            bounds.push_back(pair<double, double>{ci.first - cost, ci.second - cost});
+            best_lower = max(best_lower, ci.first - cost);
+        }
+        vector<RaceEntrant> survivors;
+        for (size_t i = 0; i < entrants.size(); i++) {
+            if (bounds[i].second >= best_lower) survivors.push_back(entrants[i]);
+        }
+        cout << "Round " << round << ": " << per_entrant << " simulations each, " << survivors.size() << " of " << entrants.size() << " values of k left." << endl;
+        entrants.swap(survivors);
+    }
+
+    size_t leader = 0;
+    vector<double> values(entrants.size());
+    for (size_t i = 0; i < entrants.size(); i++) {
+        const Tally& t = entrants[i].tally;
+        values[i] = (t.simulations > 0 ? static_cast<double>(t.switch_cnt) / t.simulations : 0) - entrants[i].k * cfg.door_cost;
+        if (values[i] > values[leader]) leader = i;
+    }
+    contenders.clear();
+    for (size_t i = 0; i < entrants.size(); i++) contenders.push_back(entrants[i].k);
+
+    int best = entrants[leader].k;
+    const Tally& t = entrants[leader].tally;
+    cout << "Best k: " << best << ", switching wins " << static_cast<double>(t.switch_cnt) / t.simulations * 100 << "% of " << t.simulations
+         << " simulations, expected value " << values[leader] * 100 << "% of the prize." << endl;
+    if (entrants.size() == 1) {
+        cout << "It is the best k with probability at least " << (1 - cfg.error_rate) * 100 << "%." << endl;
+    }
+    else {
+        cout << "The limit of " << cfg.simulations << " simulations was reached before it could be told apart from k =";
+        for (size_t i = 0; i < entrants.size(); i++) if (i != leader) cout << ' ' << entrants[i].k;
+        cout << "." << endl;
+    }
+    // Simulating every k as often as the best one would have cost this many games.
+    double full_cost = n_entrants * t.simulations;
+    cout << "Used " << used << " simulations, " << full_cost / used << "x fewer than simulating every k " << t.simulations << " times." << endl;
+    return best;
+}
+
+/*  Function to check the result of a race against the exact expected values of every k.
+    Return Type:
+    - It returns false if the exact best k is not among the `contenders` left at the end of the race.
+*/
+bool verify_race(const SimulationConfig& cfg, const vector<int>& contenders) {
+    int best = 0;
+    double best_value = -INFINITY;
+    for (int k = 0; k <= cfg.n - 2; k++) {
+        double value = exact_statistics(cfg.n, k).second.value() - k * cfg.door_cost;
+        if (value > best_value) {
+            best = k;
+            best_value = value;
+        }
+    }
+    bool found = find(contenders.begin(), contenders.end(), best) != contenders.end();
+    cout << "Race check: the exact best k is " << best << ", with expected value " << best_value * 100 << "% of the prize"
+         << (found ? "." : ", which the race dropped.") << endl;
+    return found;
+}
+
+// Number of simulations every cell of a sweep gets in the first round, and how many times its simulations may, and must at least, grow in one round.
+const long long SWEEP_FIRST_ROUND = 1024;
+const double SWEEP_MAX_GROWTH = 4;
+const double SWEEP_MIN_GROWTH = 1.1;
+
+/*  A (n, k) cell of a sweep, with the games simulated for it so far. */
+struct SweepCell {
+    int n;
+    int k;
+    Tally tally;
+};
+
+/*  Function to find the relative standard error of a win rate, or infinity if nothing was won yet. */
+double relative_error(long long wins, long long simulations) {
+    if (wins == 0) return INFINITY;
+    double p = static_cast<double>(wins) / simulations;
+    return sqrt((1 - p) / (p * simulations));
+}
+
+/*  Function to simulate every cell of a grid of door counts and opened doors, until both win rates of every cell reach a relative standard error of `cfg.target_rel_error`.
+    Return Type:
+    - It returns the cells with their tallies, and prints one line per cell.
+
+    Methodology:
+    - A win rate p estimated from N games has relative standard error sqrt((1-p) / (p N)), so a cell needs N = (1-p) / (p * target^2) games.
+      Rare win rates need many games and common ones few, so every cell gets its own number instead of a uniform budget.
+    - In the first round every cell gets `SWEEP_FIRST_ROUND` games. After each round, the needed number of games is estimated from the
+      lower ends of the Wilson intervals of the running win rates, so a rate that came out high does not promise the target too early,
+      and every cell that has not reached the target is simulated up to it, rounded up to whole batches.
+    - A round grows a cell's games at least `SWEEP_MIN_GROWTH` times, so a cell just short of the target does not take many tiny rounds,
+      and at most `SWEEP_MAX_GROWTH` times, so a noisy early estimate can not overspend much.
+    - The loop ends when every cell is on target, or when the next round would exceed `cfg.simulations` games in total.
+*/
+vector<SweepCell> sweep(const SimulationConfig& cfg, const vector<int>& doors, const vector<int>& opened) {
+    vector<SweepCell> cells;
+    for (size_t i = 0; i < doors.size(); i++) for (size_t j = 0; j < opened.size(); j++) {
+        if (opened[j] > doors[i] - 2) continue;
+        SweepCell c;
+        c.n = doors[i];
+        c.k = opened[j];
+        c.tally = empty_tally(cfg);
+        cells.push_back(c);
+    }
+
+    long long used = 0;
+    for (int round = 1; ; round++) {
+        vector<long long> targets(cells.size(), 0);
+        double round_cost = 0;
+        for (size_t i = 0; i < cells.size(); i++) {
+            const Tally& t = cells[i].tally;
+            if (t.simulations == 0) targets[i] = SWEEP_FIRST_ROUND;
+            else if (max(relative_error(t.stay_cnt, t.simulations), relative_error(t.switch_cnt, t.simulations)) > cfg.target_rel_error) {
+                double needed = SWEEP_MIN_GROWTH * t.simulations;
+                long long wins[2] = {t.stay_cnt, t.switch_cnt};
+                for (int w = 0; w < 2; w++) {
+                    double p = wilson_interval(wins[w], t.simulations, CONFIDENCE_Z).first;
+                    needed = max(needed, p > 0 ? (1 - p) / (p * cfg.target_rel_error * cfg.target_rel_error) : INFINITY);
+                }
+                needed = min(needed, SWEEP_MAX_GROWTH * t.simulations);
+                long long target = static_cast<long long>(ceil(needed));
+                targets[i] = (target + cfg.batch_size - 1) / cfg.batch_size * cfg.batch_size;
+            }
+            if (targets[i] > 0) round_cost += targets[i] - t.simulations;
+        }
+        if (round_cost == 0) break;
+        if (used + round_cost > cfg.simulations) {
+            cout << "The limit of " << cfg.simulations << " simulations was reached before every cell was on target." << endl;
+            break;
+        }
+        for (size_t i = 0; i < cells.size(); i++) {
+            if (targets[i] == 0) continue;
+            SimulationConfig cell_cfg = cfg;
+            cell_cfg.n = cells[i].n;
+            cell_cfg.k = cells[i].k;
+            long long done = cells[i].tally.simulations;
+            run_games(cell_cfg, done, targets[i] - done, cells[i].tally, NULL, NULL);
+        }
+        used += static_cast<long long>(round_cost);
+    }
+
+    long long most = 0;
+    for (size_t i = 0; i < cells.size(); i++) {
+        const Tally& t = cells[i].tally;
+        most = max(most, t.simulations);
+        cout << "n = " << cells[i].n << ", k = " << cells[i].k << ": " << t.simulations << " simulations, staying wins "
+             << static_cast<double>(t.stay_cnt) / t.simulations * 100 << "% (+-" << relative_error(t.stay_cnt, t.simulations) * 100 << "% relative), switching wins "
+             << static_cast<double>(t.switch_cnt) / t.simulations * 100 << "% (+-" << relative_error(t.switch_cnt, t.simulations) * 100 << "% relative)." << endl;
+    }
+    // Giving every cell the games of the hardest one would reach the same precision everywhere.
+    cout << "Used " << used << " simulations, " << static_cast<double>(most) * cells.size() / used << "x fewer than giving all "
+         << cells.size() << " cells the " << most << " simulations of the hardest one." << endl;
+    return cells;
+}
+
+/*  Function to read a duration like `30s`, `500ms`, `2m` or `1h` (a plain number is in seconds). Return Type: false if it is not a positive duration. */
+bool parse_duration(const string& text, double& seconds) {
+    char* unit = NULL;
+    double value = strtod(text.c_str(), &unit);
+    string suffix(unit);
+    if (unit == text.c_str() || !(value > 0)) return false;
+    if (suffix == "" || suffix == "s") seconds = value;
+    else if (suffix == "ms") seconds = value / 1000;
+    else if (suffix == "m") seconds = value * 60;
+    else if (suffix == "h") seconds = value * 3600;
+    else return false;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // Seed the random number generator.
+    srand(time(0));  
+    
+    // `MontyHall merge` takes the options of the sharded run, and the files of its shards.
+    bool merging = argc > 1 && string(argv[1]) == "merge";
+    if (merging) {
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+
+    // Invoking an instance of the cxxopts library.
+    cxxopts::Options options("MontyHall", "Monty Hall Problem Simulator");
+    options.custom_help("[merge] [OPTION...]").positional_help("[SHARD_FILE...]");
+
+    // Parse the command-line arguments if provided, else initialize with default values of original Monty Hall Problem.
+    options.add_options()
+            ("n, num_doors", "Number of doors", cxxopts::value<int>()->default_value("3"))
+            ("k, num_doors_opened_by_host", "Number of doors opened by host", cxxopts::value<int>()->default_value("1"))
+            ("s, num_simulations", "Number of simulations (the limit, with --target_ci)", cxxopts::value<long long>()->default_value("10000"))
+            ("e, engine", "Simulation routine: optimal, randomised, geometric, importance, exact or enumerate", cxxopts::value<string>()->default_value("optimal"))
+            ("t, threads", "Number of threads", cxxopts::value<int>()->default_value("1"))
+            ("trace", "File to list the won games in", cxxopts::value<string>()->default_value(""))
+            ("outcomes", "File to write the outcome of every game to", cxxopts::value<string>()->default_value(""))
+            ("verify", "Check the simulated win rates against the exact probabilities")
+            ("target_ci", "Simulate until both 95% confidence intervals are within +- this win rate", cxxopts::value<double>()->default_value("0"))
+            ("decide", "Simulate until it is settled whether switching is better than staying")
+            ("error_rate", "Error probability of --decide and --race", cxxopts::value<double>()->default_value("0.01"))
+            ("indifference", "Share of switch wins (out of all wins) away from 1/2 that --decide must detect", cxxopts::value<double>()->default_value("0.05"))
+            ("variance_reduction", "Variance reduction of the optimal engine: none, antithetic, control or both", cxxopts::value<string>()->default_value("none"))
+            ("sampling", "Draws of the optimal engine: iid, qmc or stratified", cxxopts::value<string>()->default_value("iid"))
+            ("replicates", "Number of randomized replicates of qmc or stratified sampling", cxxopts::value<int>()->default_value("16"))
+            ("importance_bias", "Share of games the importance engine forces onto the rare events", cxxopts::value<double>()->default_value("0.5"))
+            ("batch_size", "Number of games per batch of the standard errors (0 to choose it automatically)", cxxopts::value<long long>()->default_value("0"))
+            ("bootstrap", "Number of Poisson bootstrap replicates (0 for none)", cxxopts::value<int>()->default_value("0"))
+            ("checkpoints", "Report the running win rates at 10, 100, 1000, ... simulations: none or log", cxxopts::value<string>()->default_value("none"))
+            ("time_limit", "Simulate for this long, e.g. 30s, 500ms or 2m", cxxopts::value<string>()->default_value(""))
+            ("progress", "Print progress to stderr this often, e.g. 10s", cxxopts::value<string>()->default_value(""))
+            ("seed", "Seed of the games, to make a run repeatable", cxxopts::value<uint64_t>())
+            ("checkpoint_file", "File to save the state of the run to, to continue it with --resume", cxxopts::value<string>()->default_value(""))
+            ("checkpoint_every", "How often to save the state of the run, e.g. 60s", cxxopts::value<string>()->default_value("60s"))
+            ("resume", "Continue the run saved in this file, if it exists", cxxopts::value<string>()->default_value(""))
+            ("cache", "Result cache file to reuse and extend earlier runs of the same configuration", cxxopts::value<string>()->default_value(""))
+            ("shard", "Simulate only shard i/N of the games, e.g. 0/4, to combine with MontyHall merge", cxxopts::value<string>()->default_value(""))
+            ("shard_file", "File the partial results of a shard are written to (default: shard_i_of_N.part)", cxxopts::value<string>())
+            ("shard_files", "Shard files to combine, with MontyHall merge", cxxopts::value<vector<string> >())
+            ("work_dir", "Directory of a work queue shared by any number of processes", cxxopts::value<string>()->default_value(""))
+            ("chunks", "Number of chunks a work queue splits the games into", cxxopts::value<int>()->default_value("64"))
+            ("lease_timeout", "Time after which a chunk leased by a process that stopped renewing it is taken over", cxxopts::value<string>()->default_value("60s"))
+            ("processes", "Number of worker processes to fork, each with --threads threads (0 to simulate in this process)", cxxopts::value<int>()->default_value("0"))
+            ("race", "Race all numbers of opened doors to find the best one for a switching player")
+            ("door_cost", "Cost of every door opened by the host in a race, as a share of the prize", cxxopts::value<double>()->default_value("0"))
+            ("sweep_doors", "Numbers of doors of a sweep, separated by commas", cxxopts::value<vector<int> >())
+            ("sweep_opened", "Numbers of opened doors of a sweep, separated by commas (default: --num_doors_opened_by_host)", cxxopts::value<vector<int> >())
+            ("target_rel_error", "Relative standard error every cell of a sweep should reach", cxxopts::value<double>()->default_value("0.01"))
+            ("host", "Host policy of the enumerate engine: random, leftmost or ignorant", cxxopts::value<string>()->default_value("random"))
+            ("switch_rule", "Switching policy of the enumerate engine: random or leftmost", cxxopts::value<string>()->default_value("random"))
+            ("h, help", "Print usage");
+    options.parse_positional("shard_files");
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        cout << options.help() << endl;
+        exit(0);
+    }
+    // Assign the values to variables.
+    int n = result["num_doors"].as<int>();
+    int k = result["num_doors_opened_by_host"].as<int>();
+    long long s = result["num_simulations"].as<long long>();
+    string engine_name = result["engine"].as<string>();
+    int threads = result["threads"].as<int>();
+    Engine engine;
+    
+    // Error Handling.
+    if(!(3 <= n)){
+        cerr << "There must be a minimum of 3 doors to play the Monty Hall Simulator."<<endl;
+        abort();
+    }
+    if (!(0 <= k && k <= n - 2)) {
+        cerr << "Invalid number of doors given to open. Must be between 0 and (num_doors - 2)."<< endl;
+        abort(); 
+    }
+    if (s <=0) {
+        cerr << "Number of simulations must be positive."<< endl;
+        abort();
+    }
+    if (!parse_engine(engine_name, engine)) {
+        cerr << "Unknown engine. Must be optimal, randomised, geometric, importance, exact or enumerate."<< endl;
+        abort();
+    }
+    if (threads <= 0) {
+        cerr << "Number of threads must be positive."<< endl;
+        abort();
+    }
+    SimulationConfig cfg;
+    cfg.n = n;
+    cfg.k = k;
+    cfg.simulations = s;
+    cfg.engine = engine;
+    cfg.threads = threads;
+    cfg.trace = result["trace"].as<string>();
+    cfg.outcomes = result["outcomes"].as<string>();
+    cfg.verify = result.count("verify") > 0;
+    cfg.target_ci = result["target_ci"].as<double>();
+    if (cfg.target_ci < 0 || cfg.target_ci >= 1) {
+        cerr << "The target confidence interval must be between 0 and 1."<< endl;
+        abort();
+    }
+    cfg.decide = result.count("decide") > 0;
+    cfg.error_rate = result["error_rate"].as<double>();
+    cfg.indifference = result["indifference"].as<double>();
+    if (!(0 < cfg.error_rate && cfg.error_rate < 0.5)) {
+        cerr << "The error rate must be between 0 and 0.5."<< endl;
+        abort();
+    }
+    if (!(0 < cfg.indifference && cfg.indifference < 0.5)) {
+        cerr << "The indifference must be between 0 and 0.5."<< endl;
+        abort();
+    }
+    cfg.variance_reduction = result["variance_reduction"].as<string>();
+    if (cfg.variance_reduction != "none" && cfg.variance_reduction != "antithetic" && cfg.variance_reduction != "control" && cfg.variance_reduction != "both") {
+        cerr << "Unknown variance reduction. Must be none, antithetic, control or both."<< endl;
+        abort();
+    }
+    cfg.antithetic = cfg.variance_reduction == "antithetic" || cfg.variance_reduction == "both";
+    cfg.control_variate = cfg.variance_reduction == "control" || cfg.variance_reduction == "both";
+    if ((cfg.antithetic || cfg.control_variate) && (engine != ENGINE_OPTIMAL || !cfg.outcomes.empty())) {
+        cerr << "Variance reduction is only supported by the optimal engine, without --outcomes."<< endl;
+        abort();
+    }
+    if (cfg.antithetic && cfg.simulations % 2 != 0) {
+        cerr << "Number of simulations must be even with antithetic pairs."<< endl;
+        abort();
+    }
+    cfg.sampling_name = result["sampling"].as<string>();
+    if (cfg.sampling_name == "iid") cfg.sampling = SAMPLING_IID;
+    else if (cfg.sampling_name == "qmc") cfg.sampling = SAMPLING_QMC;
+    else if (cfg.sampling_name == "stratified") cfg.sampling = SAMPLING_STRATIFIED;
+    else {
+        cerr << "Unknown sampling. Must be iid, qmc or stratified."<< endl;
+        abort();
+    }
+    cfg.replicates = result["replicates"].as<int>();
+    if (cfg.sampling != SAMPLING_IID) {
+        if (engine != ENGINE_OPTIMAL || !cfg.trace.empty() || !cfg.outcomes.empty() || cfg.antithetic || cfg.control_variate || cfg.target_ci > 0 || cfg.decide) {
+            cerr << "qmc and stratified sampling are only supported by the optimal engine, for a fixed number of simulations."<< endl;
+            abort();
+        }
+        if (!(2 <= cfg.replicates && cfg.replicates <= cfg.simulations)) {
+            cerr << "Number of replicates must be between 2 and the number of simulations."<< endl;
+            abort();
+        }
+    }
+    cfg.importance_bias = result["importance_bias"].as<double>();
+    if (engine == ENGINE_IMPORTANCE) {
+        if (!(0 < cfg.importance_bias && cfg.importance_bias < 1)) {
+            cerr << "The importance bias must be between 0 and 1."<< endl;
+            abort();
+        }
+        if (!cfg.trace.empty() || !cfg.outcomes.empty() || cfg.target_ci > 0 || cfg.decide) {
+            cerr << "The importance engine only supports a fixed number of simulations, without traces."<< endl;
+            abort();
+        }
+    }
+    cfg.batch_size = result["batch_size"].as<long long>();
+    if (cfg.batch_size < 0 || (cfg.antithetic && cfg.batch_size % 2 != 0)) {
+        cerr << "The batch size must be positive, and even with antithetic pairs."<< endl;
+        abort();
+    }
+    if (cfg.batch_size == 0) {
+        cfg.batch_size = BATCH_DEFAULT_GAMES;
+        if (engine == ENGINE_GEOMETRIC) {
+            double win_rate = 1.0 / n + (n - 1.0) / (static_cast<double>(n) * (n - k - 1));
+            cfg.batch_size = max(BATCH_DEFAULT_GAMES, static_cast<long long>(ceil(BATCH_DEFAULT_WINS / win_rate)));
+        }
+        // Rounds of an adaptive run end on batch boundaries, so its batches are as small as its rounds, and it can still stop after a few hundred games.
+        else if (cfg.target_ci > 0 || cfg.decide) cfg.batch_size = ADAPTIVE_MIN_BATCH;
+    }
+    cfg.bootstrap = result["bootstrap"].as<int>();
+    if (cfg.bootstrap < 0 || (cfg.bootstrap > 0 && cfg.sampling != SAMPLING_IID)) {
+        cerr << "The number of bootstrap replicates must not be negative, and needs iid sampling."<< endl;
+        abort();
+    }
+    cfg.race = result.count("race") > 0;
+    cfg.door_cost = result["door_cost"].as<double>();
+    if (cfg.race && (engine == ENGINE_EXACT || engine == ENGINE_ENUMERATE || engine == ENGINE_IMPORTANCE || !cfg.trace.empty() || !cfg.outcomes.empty()
+                     || cfg.target_ci > 0 || cfg.decide || cfg.antithetic || cfg.control_variate || cfg.sampling != SAMPLING_IID || cfg.bootstrap > 0)) {
+        cerr << "A race only supports the optimal, randomised and geometric engines, with i.i.d. sampling and no other modes."<< endl;
+        abort();
+    }
+    if (cfg.door_cost < 0) {
+        cerr << "The door cost must not be negative."<< endl;
+        abort();
+    }
+    if (cfg.race && cfg.simulations < RACE_FIRST_ROUND * (n - 1)) {
+        cerr << "The first round of a race with " << n << " doors needs " << RACE_FIRST_ROUND * (n - 1) << " simulations, more than --num_simulations."<< endl;
+        abort();
+    }
+    vector<int> sweep_doors, sweep_opened(1, k);
+    if (result.count("sweep_doors")) sweep_doors = result["sweep_doors"].as<vector<int> >();
+    if (result.count("sweep_opened")) sweep_opened = result["sweep_opened"].as<vector<int> >();
+    cfg.target_rel_error = result["target_rel_error"].as<double>();
+    if (!sweep_doors.empty()) {
+        if (cfg.race || engine == ENGINE_EXACT || engine == ENGINE_ENUMERATE || engine == ENGINE_IMPORTANCE || !cfg.trace.empty() || !cfg.outcomes.empty()
+            || cfg.target_ci > 0 || cfg.decide || cfg.antithetic || cfg.control_variate || cfg.sampling != SAMPLING_IID || cfg.bootstrap > 0) {
+            cerr << "A sweep only supports the optimal, randomised and geometric engines, with i.i.d. sampling and no other modes."<< endl;
+            abort();
+        }
+        if (!(0 < cfg.target_rel_error && cfg.target_rel_error < 1)) {
+            cerr << "The target relative error must be between 0 and 1."<< endl;
+            abort();
+        }
+        long long cells = 0;
+        for (size_t i = 0; i < sweep_doors.size(); i++) for (size_t j = 0; j < sweep_opened.size(); j++) {
+            if (sweep_doors[i] < 3 || sweep_opened[j] < 0) {
+                cerr << "A sweep needs at least 3 doors, and can not open a negative number of doors."<< endl;
+                abort();
+            }
+            cells += sweep_opened[j] <= sweep_doors[i] - 2;
+        }
+        if (cells == 0) {
+            cerr << "No cell of the sweep leaves a door to switch to."<< endl;
+            abort();
+        }
+        // Without a limit, the sweep runs until every cell is on target.
+        if (result.count("num_simulations") == 0) cfg.simulations = LLONG_MAX;
+        if (cfg.simulations < SWEEP_FIRST_ROUND * cells) {
+            cerr << "The first round of a sweep of " << cells << " cells needs " << SWEEP_FIRST_ROUND * cells << " simulations, more than --num_simulations."<< endl;
+            abort();
+        }
+    }
+    string checkpoints = result["checkpoints"].as<string>();
+    if (checkpoints != "none" && checkpoints != "log") {
+        cerr << "Unknown checkpoints. Must be none or log."<< endl;
+        abort();
+    }
+    if (checkpoints == "log" && (cfg.sampling != SAMPLING_IID || cfg.race || !sweep_doors.empty())) {
+        cerr << "Checkpoints need iid sampling, and are not supported by races and sweeps."<< endl;
+        abort();
+    }
+    cfg.time_limit = 0;
+    cfg.deadline = chrono::steady_clock::time_point::max();
+    string time_limit = result["time_limit"].as<string>();
+    if (!time_limit.empty()) {
+        if (!parse_duration(time_limit, cfg.time_limit)) {
+            cerr << "The time limit must be a positive duration, like 30s, 500ms or 2m."<< endl;
+            abort();
+        }
+        if (cfg.sampling != SAMPLING_IID || cfg.race || !sweep_doors.empty()) {
+            cerr << "A time limit needs iid sampling, and is not supported by races and sweeps."<< endl;
+            abort();
+        }
+    }
+    cfg.progress = 0;
+    string progress = result["progress"].as<string>();
+    if (!progress.empty()) {
+        if (!parse_duration(progress, cfg.progress)) {
+            cerr << "The progress interval must be a positive duration, like 10s or 500ms."<< endl;
+            abort();
+        }
+        if (cfg.sampling != SAMPLING_IID || cfg.race || !sweep_doors.empty()) {
+            cerr << "Progress lines need iid sampling, and are not supported by races and sweeps."<< endl;
+            abort();
+        }
+    }
+    cfg.checkpoint_file = result["checkpoint_file"].as<string>();
+    cfg.resume = result["resume"].as<string>();
+    if (!parse_duration(result["checkpoint_every"].as<string>(), cfg.checkpoint_every)) {
+        cerr << "The interval between saves must be a positive duration, like 60s or 10m."<< endl;
+        abort();
+    }
+    if ((!cfg.checkpoint_file.empty() || !cfg.resume.empty())
+        && (cfg.sampling != SAMPLING_IID || cfg.race || !sweep_doors.empty() || !cfg.trace.empty() || !cfg.outcomes.empty())) {
+        cerr << "Saving and resuming a run needs iid sampling, and is not supported by races, sweeps, traces and outcome files."<< endl;
+        abort();
+    }
+    cfg.cache = result["cache"].as<string>();
+    if (!cfg.cache.empty() && (cfg.sampling != SAMPLING_IID || cfg.race || !sweep_doors.empty() || !cfg.trace.empty() || !cfg.outcomes.empty()
+                               || cfg.bootstrap > 0 || checkpoints != "none" || !cfg.checkpoint_file.empty() || !cfg.resume.empty())) {
+        cerr << "The result cache needs iid sampling, and is not supported by races, sweeps, traces, outcome files, bootstrap replicates, "
+             << "checkpoints and saved runs."<< endl;
+        abort();
+    }
+    cfg.shard = cfg.shards = 0;
+    string shard = result["shard"].as<string>();
+    if (!shard.empty()) {
+        char slash = 0, rest = 0;
+        if (sscanf(shard.c_str(), "%d %c %d %c", &cfg.shard, &slash, &cfg.shards, &rest) != 3 || slash != '/' || cfg.shards < 1 || cfg.shard < 0 || cfg.shard >= cfg.shards) {
+            cerr << "The shard must be i/N, with 0 <= i < N, e.g. 0/4."<< endl;
+            abort();
+        }
+        if (result.count("seed") == 0) {
+            cerr << "Every shard of a run needs the same --seed."<< endl;
+            abort();
+        }
+        cfg.shard_file = result.count("shard_file") ? result["shard_file"].as<string>() : "shard_" + to_string(cfg.shard) + "_of_" + to_string(cfg.shards) + ".part";
+    }
+    cfg.work_dir = result["work_dir"].as<string>();
+    cfg.chunks = result["chunks"].as<int>();
+    if (cfg.chunks < 1) {
+        cerr << "The number of chunks must be at least 1."<< endl;
+        abort();
+    }
+    if (!parse_duration(result["lease_timeout"].as<string>(), cfg.lease_timeout)) {
+        cerr << "The lease timeout must be a positive duration, like 60s or 5m."<< endl;
+        abort();
+    }
+    if (!cfg.work_dir.empty() && (cfg.shards > 0 || merging)) {
+        cerr << "A work queue splits the run itself, so it can not be combined with --shard or MontyHall merge."<< endl;
+        abort();
+    }
+    cfg.processes = result["processes"].as<int>();
+    if (cfg.processes < 0) {
+        cerr << "The number of worker processes can not be negative."<< endl;
+        abort();
+    }
+    if (cfg.processes > 0 && (cfg.shards > 0 || merging || !cfg.work_dir.empty())) {
+        cerr << "Worker processes can not be combined with --shard, --work_dir or MontyHall merge."<< endl;
+        abort();
+    }
+    if ((cfg.shards > 0 || merging || !cfg.work_dir.empty() || cfg.processes > 0)
+        && (cfg.sampling != SAMPLING_IID || cfg.race || !sweep_doors.empty() || !cfg.trace.empty() || !cfg.outcomes.empty() || cfg.target_ci > 0 || cfg.decide
+            || cfg.time_limit > 0 || cfg.progress > 0 || !cfg.checkpoint_file.empty() || !cfg.resume.empty() || !cfg.cache.empty())) {
+        cerr << "Shards, work queues and worker processes need iid sampling and a fixed number of simulations, and are not supported by races, sweeps, traces, "
+             << "outcome files, progress lines, saved runs and the result cache."<< endl;
+        abort();
+    }
+    vector<string> shard_files;
+    if (result.count("shard_files")) shard_files = result["shard_files"].as<vector<string> >();
+    if (merging != !shard_files.empty()) {
+        cerr << (merging ? "MontyHall merge needs the files of the shards." : "Unexpected arguments. Shard files can only be given to MontyHall merge.")<< endl;
+        abort();
+    }
+    // A run that is saved or resumed is seeded, with the saved seed or a random one if no seed is given.
+    cfg.seeded = result.count("seed") > 0;
+    if (cfg.seeded) cfg.seed = result["seed"].as<uint64_t>();
+    else if (!cfg.resume.empty() && saved_run_seed(cfg.resume, cfg.seed)) cfg.seeded = true;
+    else if (!cfg.checkpoint_file.empty() || !cfg.resume.empty()) {
+        cfg.seed = static_cast<uint64_t>(rng()) << 32 | rng();
+        cfg.seeded = true;
+    }
+    if (cfg.seeded) rng.seed(static_cast<unsigned>(cfg.seed ^ cfg.seed >> 32));
+    // The number of simulations only limits an adaptive or time-limited run if it was asked for.
+    if ((cfg.target_ci > 0 || cfg.decide || cfg.time_limit > 0) && result.count("num_simulations") == 0) cfg.simulations = LLONG_MAX;
+    if (checkpoints == "log") {
+        for (long long c = 10; c < cfg.simulations; c = c <= LLONG_MAX / 10 ? c * 10 : LLONG_MAX) cfg.checkpoints.push_back(c);
+        cfg.checkpoints.push_back(cfg.simulations);
+    }
+    if (!cfg.outcomes.empty() && engine == ENGINE_GEOMETRIC) {
+        cerr << "The geometric engine skips the lost games, so it can not write the outcome of every game. Use --trace instead."<< endl;
+        abort();
+    }
+
+    string host_name = result["host"].as<string>();
+    string switch_name = result["switch_rule"].as<string>();
+    if ((host_name != "random" || switch_name != "random") && engine != ENGINE_ENUMERATE) {
+        cerr << "Host and switching policies are only supported by the enumerate engine."<< endl;
+        abort();
+    }
+    if (host_name != "random" && host_name != "leftmost" && host_name != "ignorant") {
+        cerr << "Unknown host policy. Must be random, leftmost or ignorant."<< endl;
+        abort();
+    }
+    if (switch_name != "random" && switch_name != "leftmost") {
+        cerr << "Unknown switching policy. Must be random or leftmost."<< endl;
+        abort();
+    }
+    if (engine == ENGINE_ENUMERATE && n > ENUMERATE_MAX_DOORS) {
+        cerr << "The enumerate engine supports at most " << ENUMERATE_MAX_DOORS << " doors."<< endl;
+        abort();
+    }
+    if (engine == ENGINE_EXACT || engine == ENGINE_ENUMERATE) {
+        cout << "Exact Results" << endl;
+        if (engine == ENGINE_EXACT) print_exact(exact_statistics(n, k));
+        else {
+            HostPolicy host = host_name == "random" ? HOST_RANDOM : host_name == "leftmost" ? HOST_LEFTMOST : HOST_IGNORANT;
+            SwitchPolicy switch_rule = switch_name == "random" ? SWITCH_RANDOM : SWITCH_LEFTMOST;
+            print_exact(enumerate_statistics(n, k, host, switch_rule));
+        }
+        return 0;
+    }
+    if (!sweep_doors.empty()) {
+        cout << "Sweep Results" << endl;
+        vector<SweepCell> cells = sweep(cfg, sweep_doors, sweep_opened);
+        bool consistent = true;
+        for (size_t i = 0; cfg.verify && i < cells.size(); i++) {
+            const Tally& t = cells[i].tally;
+            cout << "n = " << cells[i].n << ", k = " << cells[i].k << ":" << endl;
+            consistent = verify_against_exact(cells[i].n, cells[i].k, t.simulations, t.stay_cnt, t.switch_cnt) && consistent;
+        }
+        return consistent ? 0 : 1;
+    }
+    if (cfg.race) {
+        cout << "Race Results" << endl;
+        vector<int> contenders;
+        race_doors(cfg, contenders);
+        if (cfg.verify && !verify_race(cfg, contenders)) return 1;
+        return 0;
+    }
+    if (cfg.shards > 0) {
+        long long first, end;
+        shard_range(cfg, first, end);
+        Tally tally = empty_tally(cfg);
+        run_games(cfg, first, end - first, tally, NULL, NULL);
+        write_shard(cfg, tally, first, end);
+        cout << "Shard Results" << endl;
+        cout << "Shard " << cfg.shard << " of " << cfg.shards << ": simulations " << first << " to " << end << ", staying wins " << tally.stay_cnt
+             << ", switching wins " << tally.switch_cnt << ", written to " << cfg.shard_file << "." << endl;
+        return 0;
+    }
+    if (merging) {
+        cout << "Merge Results" << endl;
+        Tally tally;
+        if (!merge_shards(cfg, shard_files, tally)) abort();
+        return report_merged(cfg, tally) ? 0 : 1;
+    }
+    if (cfg.processes > 0) {
+#ifdef _WIN32
+        cerr << "Worker processes need fork(), which is not supported on Windows."<< endl;
+        abort();
+#else
+        cout << "Simulation Results" << endl;
+        vector<long long> per_worker;
+        Tally tally = simulate_processes(cfg, per_worker);
+        cout << "Simulated by " << cfg.processes << " worker processes, with";
+        for (size_t w = 0; w < per_worker.size(); w++) cout << (w == 0 ? " " : ", ") << per_worker[w];
+        cout << " simulations." << endl;
+        return report_merged(cfg, tally) ? 0 : 1;
+#endif
+    }
+    if (!cfg.work_dir.empty()) {
+#ifdef _WIN32
+        cerr << "The work queue needs POSIX file operations, which are not supported on Windows."<< endl;
+        abort();
+#else
+        return run_work_queue(cfg) ? 0 : 1;
+#endif
+    }
+    ResultCache cache;
+    string key;
+    bool hit = false;
+    CachedResult cached;
+    if (!cfg.cache.empty()) {
+        if (!cache.open_file(cfg.cache)) abort();
+        key = cache_key(cfg, cfg.seeded);
+        if (key.size() >= CACHE_KEY_SIZE) {
+            cerr << "The options of this run are too long for a cache key."<< endl;
+            abort();
+        }
+        hit = cache.find(key, cached);
+        cfg.seed = hit ? cached.seed : cfg.seeded ? cfg.seed : static_cast<uint64_t>(rng()) << 32 | rng();
+        cfg.seeded = true;
+    }
+    cout << "Simulation Results" << endl;
+    if (hit) cout << "Found " << cached.simulations << " simulations of this configuration in " << cfg.cache << "." << endl;
+    if (cfg.time_limit > 0) cfg.deadline = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(cfg.time_limit));
+    Tally start;
+    if (hit) start = cached_tally(cfg, cached);
+    Tally tally = simulate(cfg, hit ? &start : NULL);
+    if (!cfg.cache.empty() && (!hit || tally.simulations > cached.simulations)) {
+        if (cache.store(key, cached_result(cfg, tally))) cout << "Saved " << tally.simulations << " simulations of this configuration to " << cfg.cache << "." << endl;
+        else cout << "The cache " << cfg.cache << " is full, so the results were not saved." << endl;
+    }
+    if (cfg.verify && engine == ENGINE_IMPORTANCE) {
+        double estimates[2], std_errors[2];
+        importance_estimates(n, k, cfg.importance_bias, tally.simulations, tally.stay_cnt, tally.switch_cnt, estimates, std_errors);
+        if (!verify_estimates(n, k, estimates, std_errors)) return 1;
+    }
+    else if (cfg.verify && !verify_against_exact(n, k, tally.simulations, tally.stay_cnt, tally.switch_cnt)) return 1;
+    // A run stopped by a signal exits with the status a shell gives a program killed by it.
+    if (stop_requested) return 128 + stop_signal;
     
     return 0;
 }